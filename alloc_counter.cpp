@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <execinfo.h>
+#include <stdint.h>
+#include "alloc_counter.h"
+
+static const int MAX_SITE_DEPTH = 12;
+static const int SKIPPED_FRAMES = 3;    // record_site, record_allocation and the interposed function
+static const size_t MAX_SITES = 512;
+
+struct SiteSlot {
+    uint64_t hash;    // 0 while unused
+    int depth;
+    void* frames[MAX_SITE_DEPTH];
+    size_t allocations;
+    size_t bytes;
+};
+
+static std::atomic<bool> counting(false);
+static std::atomic<bool> recording(false);
+static std::atomic<size_t> allocations(0);
+static std::atomic<size_t> allocated_bytes(0);
+static std::atomic<size_t> frees(0);
+static std::atomic<size_t> dropped_sites(0);
+
+// fixed table, the hook itself must not allocate
+static SiteSlot sites[MAX_SITES];
+static std::atomic_flag sites_lock = ATOMIC_FLAG_INIT;
+
+// backtrace() may allocate on its first call, those allocations are not recorded
+static __thread bool in_hook = false;
+
+static inline uint64_t hash_frames(void* const* frames, const int& depth) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < depth; i++) {
+        hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i])) * 1099511628211ULL;
+    }
+    return hash | 1;
+}
+
+// not inlined, so the frames to skip are the same at any optimization level
+static __attribute__((noinline)) void record_site(const size_t& size) {
+    void* frames[MAX_SITE_DEPTH + SKIPPED_FRAMES];
+    int depth = backtrace(frames, MAX_SITE_DEPTH + SKIPPED_FRAMES) - SKIPPED_FRAMES;
+    if (depth <= 0) {
+        dropped_sites++;
+        return;
+    }
+    void* const* site = frames + SKIPPED_FRAMES;
+    const uint64_t hash = hash_frames(site, depth);
+    while (sites_lock.test_and_set(std::memory_order_acquire)) {
+    }
+    bool stored = false;
+    for (size_t probe = 0; probe < MAX_SITES && !stored; probe++) {
+        SiteSlot& slot = sites[(hash + probe) % MAX_SITES];
+        if (slot.hash == 0) {
+            slot.hash = hash;
+            slot.depth = depth;
+            memcpy(slot.frames, site, depth * sizeof(void*));
+        }
+        if (slot.hash == hash) {
+            slot.allocations++;
+            slot.bytes += size;
+            stored = true;
+        }
+    }
+    sites_lock.clear(std::memory_order_release);
+    if (!stored) {
+        dropped_sites++;
+    }
+}
+
+static __attribute__((noinline)) void record_allocation(const size_t& size) {
+    if (!counting.load(std::memory_order_relaxed) || in_hook) {
+        return;
+    }
+    in_hook = true;
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (recording.load(std::memory_order_relaxed)) {
+        record_site(size);
+    }
+    in_hook = false;
+}
+
+static inline void record_free(void* ptr) {
+    if (ptr && counting.load(std::memory_order_relaxed)) {
+        frees.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#ifdef GAME_VIDEO_ALLOC_HOOK
+
+// glibc's allocator under its internal names
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void* __libc_memalign(size_t, size_t);
+void __libc_free(void*);
+}
+
+extern "C" void* malloc(size_t size) {
+    record_allocation(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    record_allocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size) {
+    if (size > 0) {
+        record_allocation(size);
+    } else {
+        record_free(ptr);
+    }
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void* memalign(size_t alignment, size_t size) {
+    record_allocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size) {
+    record_allocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+        return 22;    // EINVAL
+    }
+    record_allocation(size);
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : 12;    // ENOMEM
+}
+
+extern "C" void free(void* ptr) {
+    record_free(ptr);
+    __libc_free(ptr);
+}
+
+bool allocation_hook_installed() {
+    return true;
+}
+
+#else
+
+bool allocation_hook_installed() {
+    return false;
+}
+
+#endif
+
+void start_allocation_count(const bool& record_sites) {
+    counting = false;
+    if (record_sites) {
+        // loads the unwinder now rather than inside the first counted allocation
+        void* frames[1];
+        backtrace(frames, 1);
+    }
+    while (sites_lock.test_and_set(std::memory_order_acquire)) {
+    }
+    memset(sites, 0, sizeof(sites));
+    sites_lock.clear(std::memory_order_release);
+    allocations = 0;
+    allocated_bytes = 0;
+    frees = 0;
+    dropped_sites = 0;
+    recording = record_sites;
+    counting = true;
+}
+
+AllocationStats stop_allocation_count() {
+    counting = false;
+    AllocationStats stats = {allocations.load(), allocated_bytes.load(), frees.load(), dropped_sites.load()};
+    return stats;
+}
+
+size_t counted_allocations() {
+    return allocations.load();
+}
+
+// "module(mangled+0x1c) [0x...]" with the symbol demangled
+static std::string demangle_frame(const char* symbol) {
+    std::string line = symbol;
+    size_t open = line.find('(');
+    size_t plus = line.find('+', open);
+    if (open == std::string::npos || plus == std::string::npos || plus == open + 1) {
+        return line;
+    }
+    std::string mangled = line.substr(open + 1, plus - open - 1);
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(mangled.c_str(), NULL, NULL, &status);
+    if (status != 0 || !demangled) {
+        return line;
+    }
+    line.replace(open + 1, mangled.size(), demangled);
+    free(demangled);
+    return line;
+}
+
+static bool more_allocations(const SiteSlot* a, const SiteSlot* b) {
+    return a->allocations > b->allocations;
+}
+
+void allocation_sites(const size_t& top, std::vector<AllocationSite>* result) {
+    result->clear();
+    std::vector<const SiteSlot*> used;
+    for (size_t i = 0; i < MAX_SITES; i++) {
+        if (sites[i].hash != 0) {
+            used.push_back(&sites[i]);
+        }
+    }
+    std::sort(used.begin(), used.end(), more_allocations);
+    for (size_t i = 0; i < used.size() && i < top; i++) {
+        AllocationSite site;
+        site.allocations = used[i]->allocations;
+        site.bytes = used[i]->bytes;
+        char** symbols = backtrace_symbols(used[i]->frames, used[i]->depth);
+        for (int f = 0; f < used[i]->depth; f++) {
+            site.frames.push_back(symbols ? demangle_frame(symbols[f]) : std::string("?"));
+        }
+        free(symbols);
+        result->push_back(site);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <string>
+#include <vector>
+
+// Counts heap allocations of the whole process, all threads, while enabled.
+// Built with -DGAME_VIDEO_ALLOC_HOOK=ON, the executable interposes malloc, calloc, realloc,
+// memalign, posix_memalign and aligned_alloc, so operator new and OpenCV's fastMalloc (aligned
+// allocation on Linux) are counted too; each counted allocation can record its call stack.
+// Without the option nothing is interposed and allocation_hook_installed() is false.
+// This header and alloc_counter.cpp do not depend on OpenCV.
+
+struct AllocationStats {
+    size_t allocations;    // realloc counts as one
+    size_t bytes;
+    size_t frees;
+    size_t dropped_sites;    // allocations whose call stack did not fit the site table
+};
+
+struct AllocationSite {
+    size_t allocations;
+    size_t bytes;
+    std::vector<std::string> frames;    // innermost first, demangled where possible
+};
+
+bool allocation_hook_installed();
+
+// resets the counters and starts counting, with call stacks when record_sites
+void start_allocation_count(const bool& record_sites);
+AllocationStats stop_allocation_count();
+// allocations counted so far, while counting
+size_t counted_allocations();
+
+// call sites of the last count, most allocations first
+void allocation_sites(const size_t& top, std::vector<AllocationSite>*);
+
+#endif
@@ -0,0 +1,423 @@
+#include <cstring>
+#include <deque>
+#include <algorithm>
+#include "arrow_writer.h"
+
+// Minimal flatbuffers serializer for the Arrow metadata tables (Schema.fbs, Message.fbs, File.fbs).
+// Objects are laid out parent first, so every uoffset points forward as the format requires.
+class FlatBuilder {
+  public:
+    struct Node {
+        enum Kind { TABLE, TABLE_VECTOR, STRUCT_VECTOR, STRING };
+        struct Field {
+            int id;
+            size_t size;       // scalar size, 4 for offsets to child objects
+            uint64_t value;
+            Node* child;
+        };
+        Kind kind;
+        std::vector<Field> fields;       // TABLE
+        std::vector<Node*> elements;     // TABLE_VECTOR
+        std::vector<uint8_t> bytes;      // STRUCT_VECTOR, STRING
+        size_t count;                    // STRUCT_VECTOR
+    };
+
+    Node* table() {
+        return node(Node::TABLE);
+    }
+    void scalar(Node* table, const int& id, const size_t& size, const uint64_t& value) {
+        Node::Field field = {id, size, value, NULL};
+        table->fields.push_back(field);
+    }
+    void offset(Node* table, const int& id, Node* child) {
+        Node::Field field = {id, 4, 0, child};
+        table->fields.push_back(field);
+    }
+    Node* string(const std::string& text) {
+        Node* n = node(Node::STRING);
+        n->bytes.assign(text.begin(), text.end());
+        return n;
+    }
+    Node* tables(const std::vector<Node*>& elements) {
+        Node* n = node(Node::TABLE_VECTOR);
+        n->elements = elements;
+        return n;
+    }
+    // structs in Arrow metadata (FieldNode, Buffer, Block) are all 8-byte aligned
+    Node* structs(const void* data, const size_t& count, const size_t& struct_size) {
+        Node* n = node(Node::STRUCT_VECTOR);
+        n->bytes.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + count * struct_size);
+        n->count = count;
+        return n;
+    }
+
+    std::vector<uint8_t> finish(Node* root) {
+        buf_.assign(4, 0);
+        patch(0, serialize(root));
+        align(8);
+        return buf_;
+    }
+
+  private:
+    std::deque<Node> nodes_;
+    std::vector<uint8_t> buf_;
+
+    Node* node(const Node::Kind& kind) {
+        nodes_.push_back(Node());
+        nodes_.back().kind = kind;
+        nodes_.back().count = 0;
+        return &nodes_.back();
+    }
+    void align(const size_t& alignment) {
+        while (buf_.size() % alignment != 0) {
+            buf_.push_back(0);
+        }
+    }
+    void put(const uint64_t& value, const size_t& size) {
+        for (size_t i = 0; i < size; i++) {
+            buf_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+    void set(const size_t& pos, const uint64_t& value, const size_t& size) {
+        for (size_t i = 0; i < size; i++) {
+            buf_[pos + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+    // uoffset at pos pointing to target
+    void patch(const size_t& pos, const size_t& target) {
+        set(pos, target - pos, 4);
+    }
+
+    size_t serialize(Node* n) {
+        if (n->kind == Node::STRING) {
+            align(4);
+            size_t pos = buf_.size();
+            put(n->bytes.size(), 4);
+            buf_.insert(buf_.end(), n->bytes.begin(), n->bytes.end());
+            buf_.push_back(0);
+            return pos;
+        }
+        if (n->kind == Node::STRUCT_VECTOR) {
+            // elements 8-byte aligned, right after the 4-byte length
+            align(4);
+            if (buf_.size() % 8 == 0) {
+                put(0, 4);
+            }
+            size_t pos = buf_.size();
+            put(n->count, 4);
+            buf_.insert(buf_.end(), n->bytes.begin(), n->bytes.end());
+            return pos;
+        }
+        if (n->kind == Node::TABLE_VECTOR) {
+            align(4);
+            size_t pos = buf_.size();
+            put(n->elements.size(), 4);
+            for (size_t i = 0; i < n->elements.size(); i++) {
+                put(0, 4);
+            }
+            for (size_t i = 0; i < n->elements.size(); i++) {
+                patch(pos + 4 + 4 * i, serialize(n->elements[i]));
+            }
+            return pos;
+        }
+
+        // table: vtable, then soffset to it followed by fields, largest first for alignment
+        std::vector<Node::Field> fields = n->fields;
+        std::stable_sort(fields.begin(), fields.end(), [](const Node::Field& a, const Node::Field& b) {
+            return a.size > b.size;
+        });
+        int max_id = -1;
+        bool has_long = false;
+        for (size_t i = 0; i < fields.size(); i++) {
+            max_id = std::max(max_id, fields[i].id);
+            has_long = has_long || fields[i].size == 8;
+        }
+        align(2);
+        size_t vtable = buf_.size();
+        size_t pos = (vtable + 4 + 2 * (max_id + 1) + 3) / 4 * 4;
+        if (has_long && pos % 8 == 0) {
+            pos += 4;
+        }
+        std::vector<uint16_t> field_offsets(max_id + 1, 0);
+        size_t table_size = 4;
+        for (size_t i = 0; i < fields.size(); i++) {
+            while ((pos + table_size) % fields[i].size != 0) {
+                table_size++;
+            }
+            field_offsets[fields[i].id] = static_cast<uint16_t>(table_size);
+            table_size += fields[i].size;
+        }
+
+        put(4 + 2 * field_offsets.size(), 2);
+        put(table_size, 2);
+        for (size_t i = 0; i < field_offsets.size(); i++) {
+            put(field_offsets[i], 2);
+        }
+        buf_.resize(pos, 0);
+        buf_.resize(pos + table_size, 0);
+        set(pos, static_cast<uint32_t>(pos - vtable), 4);
+        for (size_t i = 0; i < fields.size(); i++) {
+            set(pos + field_offsets[fields[i].id], fields[i].value, fields[i].size);
+        }
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (fields[i].child) {
+                patch(pos + field_offsets[fields[i].id], serialize(fields[i].child));
+            }
+        }
+        return pos;
+    }
+};
+
+typedef FlatBuilder::Node FbNode;
+
+// Arrow enums, see Schema.fbs and Message.fbs
+static const int METADATA_V5 = 4;
+static const int TYPE_INT = 2;
+static const int TYPE_FLOATING_POINT = 3;
+static const int TYPE_LIST = 12;
+static const int TYPE_STRUCT = 13;
+static const int PRECISION_DOUBLE = 2;
+static const int HEADER_SCHEMA = 1;
+static const int HEADER_RECORD_BATCH = 3;
+
+static const char ARROW_MAGIC[6] = {'A', 'R', 'R', 'O', 'W', '1'};
+static const size_t BODY_ALIGNMENT = 64;
+
+static const char* INT_COLUMNS[9] = {"ts", "spell1_cd", "spell2_cd", "spell3_cd", "skill1_cd", "skill2_cd", "skill3_cd", "skill4_cd", "money"};
+static const char* HERO_COLUMNS[4] = {"hero_id", "x", "y", "level"};
+
+// Field table: name 0, nullable 1, type_type 2, type 3, dictionary 4, children 5
+static FbNode* arrow_field(FlatBuilder* fb, const std::string& name, const int& type_type, FbNode* type, const std::vector<FbNode*>& children) {
+    FbNode* field = fb->table();
+    fb->offset(field, 0, fb->string(name));
+    fb->scalar(field, 1, 1, 0);
+    fb->scalar(field, 2, 1, type_type);
+    fb->offset(field, 3, type);
+    fb->offset(field, 5, fb->tables(children));
+    return field;
+}
+
+static FbNode* int32_field(FlatBuilder* fb, const std::string& name) {
+    FbNode* type = fb->table();
+    fb->scalar(type, 0, 4, 32);
+    fb->scalar(type, 1, 1, 1);
+    return arrow_field(fb, name, TYPE_INT, type, std::vector<FbNode*>());
+}
+
+static FbNode* frame_status_schema(FlatBuilder* fb) {
+    std::vector<FbNode*> fields;
+    fields.push_back(int32_field(fb, INT_COLUMNS[0]));
+    FbNode* float64 = fb->table();
+    fb->scalar(float64, 0, 2, PRECISION_DOUBLE);
+    fields.push_back(arrow_field(fb, "joystick_angle", TYPE_FLOATING_POINT, float64, std::vector<FbNode*>()));
+    for (size_t i = 1; i < 9; i++) {
+        fields.push_back(int32_field(fb, INT_COLUMNS[i]));
+    }
+    std::vector<FbNode*> hero_fields;
+    for (size_t i = 0; i < 4; i++) {
+        hero_fields.push_back(int32_field(fb, HERO_COLUMNS[i]));
+    }
+    FbNode* hero = arrow_field(fb, "item", TYPE_STRUCT, fb->table(), hero_fields);
+    fields.push_back(arrow_field(fb, "hero_list", TYPE_LIST, fb->table(), std::vector<FbNode*>(1, hero)));
+
+    // Schema table: endianness 0 (little), fields 1
+    FbNode* schema = fb->table();
+    fb->scalar(schema, 0, 2, 0);
+    fb->offset(schema, 1, fb->tables(fields));
+    return schema;
+}
+
+// Message table: version 0, header_type 1, header 2, bodyLength 3
+static std::vector<uint8_t> arrow_message(FlatBuilder* fb, const int& header_type, FbNode* header, const int64_t& body_length) {
+    FbNode* message = fb->table();
+    fb->scalar(message, 0, 2, METADATA_V5);
+    fb->scalar(message, 1, 1, header_type);
+    fb->offset(message, 2, header);
+    fb->scalar(message, 3, 8, body_length);
+    return fb->finish(message);
+}
+
+ArrowWriter::ArrowWriter() : file_(NULL), format_(ARROW_FILE), batch_size_(65536), offset_(0), ok_(false) {}
+
+ArrowWriter::~ArrowWriter() {
+    close();
+}
+
+void ArrowWriter::write_bytes(const void* data, const size_t& size) {
+    if (size > 0 && fwrite(data, 1, size, file_) != size) {
+        ok_ = false;
+    }
+    offset_ += size;
+}
+
+void ArrowWriter::write_message(const std::vector<uint8_t>& metadata, const std::vector<uint8_t>& body, Block* block) {
+    // continuation marker, metadata length, metadata padded so the body starts aligned
+    size_t padded = metadata.size();
+    while ((offset_ + 8 + padded) % BODY_ALIGNMENT != 0) {
+        padded += 8;
+    }
+    const uint32_t continuation = 0xFFFFFFFF;
+    const int32_t length = static_cast<int32_t>(padded);
+    const uint8_t zeros[BODY_ALIGNMENT] = {0};
+    block->offset = offset_;
+    block->metadata_length = 8 + length;
+    block->body_length = body.size();
+    write_bytes(&continuation, 4);
+    write_bytes(&length, 4);
+    write_bytes(&metadata[0], metadata.size());
+    write_bytes(zeros, padded - metadata.size());
+    if (!body.empty()) {
+        write_bytes(&body[0], body.size());
+    }
+}
+
+bool ArrowWriter::open(const std::string& path, const Format& format, const size_t& batch_size) {
+    close();
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    format_ = format;
+    batch_size_ = std::max<size_t>(1, batch_size);
+    offset_ = 0;
+    ok_ = true;
+    blocks_.clear();
+    hero_offsets_.assign(1, 0);
+
+    if (format_ == ARROW_FILE) {
+        const char padding[2] = {0, 0};
+        write_bytes(ARROW_MAGIC, sizeof(ARROW_MAGIC));
+        write_bytes(padding, sizeof(padding));
+    }
+    FlatBuilder fb;
+    Block block;
+    write_message(arrow_message(&fb, HEADER_SCHEMA, frame_status_schema(&fb), 0), std::vector<uint8_t>(), &block);
+    return ok_;
+}
+
+bool ArrowWriter::write(const FrameStatus& status) {
+    const int values[9] = {status.ts, status.spell1_cd, status.spell2_cd, status.spell3_cd,
+                           status.skill1_cd, status.skill2_cd, status.skill3_cd, status.skill4_cd, status.money};
+    for (size_t i = 0; i < 9; i++) {
+        ints_[i].push_back(values[i]);
+    }
+    joystick_angle_.push_back(status.joystick_angle);
+    for (size_t i = 0; i < status.hero_list.size(); i++) {
+        heroes_[0].push_back(status.hero_list[i].hero_id);
+        heroes_[1].push_back(status.hero_list[i].position.x);
+        heroes_[2].push_back(status.hero_list[i].position.y);
+        heroes_[3].push_back(status.hero_list[i].level);
+    }
+    hero_offsets_.push_back(static_cast<int32_t>(heroes_[0].size()));
+    if (joystick_angle_.size() >= batch_size_) {
+        return flush_batch();
+    }
+    return ok_;
+}
+
+// FieldNode {int64 length, int64 null_count} and Buffer {int64 offset, int64 length}
+struct ArrowPair {
+    int64_t first;
+    int64_t second;
+};
+
+static void append_buffer(std::vector<uint8_t>* body, std::vector<ArrowPair>* buffers, const void* data, const size_t& size) {
+    ArrowPair buffer = {static_cast<int64_t>(body->size()), static_cast<int64_t>(size)};
+    buffers->push_back(buffer);
+    if (size > 0) {
+        body->insert(body->end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    }
+    body->resize((body->size() + BODY_ALIGNMENT - 1) / BODY_ALIGNMENT * BODY_ALIGNMENT, 0);
+}
+
+bool ArrowWriter::flush_batch() {
+    const int64_t rows = joystick_angle_.size();
+    if (rows == 0) {
+        return ok_;
+    }
+    const int64_t heroes = heroes_[0].size();
+
+    // nodes and buffers in schema pre-order, no nulls so validity bitmaps are empty
+    std::vector<ArrowPair> nodes, buffers;
+    std::vector<uint8_t> body;
+    for (size_t c = 0; c < 10; c++) {
+        ArrowPair node = {rows, 0};
+        nodes.push_back(node);
+        append_buffer(&body, &buffers, NULL, 0);
+        if (c == 1) {
+            append_buffer(&body, &buffers, &joystick_angle_[0], rows * sizeof(double));
+        } else {
+            const std::vector<int32_t>& column = ints_[c == 0 ? 0 : c - 1];
+            append_buffer(&body, &buffers, &column[0], rows * sizeof(int32_t));
+        }
+    }
+    ArrowPair list_node = {rows, 0};
+    nodes.push_back(list_node);
+    append_buffer(&body, &buffers, NULL, 0);
+    append_buffer(&body, &buffers, &hero_offsets_[0], hero_offsets_.size() * sizeof(int32_t));
+    ArrowPair struct_node = {heroes, 0};
+    nodes.push_back(struct_node);
+    append_buffer(&body, &buffers, NULL, 0);
+    for (size_t c = 0; c < 4; c++) {
+        ArrowPair node = {heroes, 0};
+        nodes.push_back(node);
+        append_buffer(&body, &buffers, NULL, 0);
+        append_buffer(&body, &buffers, heroes > 0 ? &heroes_[c][0] : NULL, heroes * sizeof(int32_t));
+    }
+
+    // RecordBatch table: length 0, nodes 1, buffers 2
+    FlatBuilder fb;
+    FbNode* batch = fb.table();
+    fb.scalar(batch, 0, 8, rows);
+    fb.offset(batch, 1, fb.structs(&nodes[0], nodes.size(), sizeof(ArrowPair)));
+    fb.offset(batch, 2, fb.structs(&buffers[0], buffers.size(), sizeof(ArrowPair)));
+    Block block;
+    write_message(arrow_message(&fb, HEADER_RECORD_BATCH, batch, body.size()), body, &block);
+    blocks_.push_back(block);
+
+    for (size_t i = 0; i < 9; i++) {
+        ints_[i].clear();
+    }
+    joystick_angle_.clear();
+    hero_offsets_.assign(1, 0);
+    for (size_t i = 0; i < 4; i++) {
+        heroes_[i].clear();
+    }
+    return ok_;
+}
+
+bool ArrowWriter::close() {
+    if (!file_) {
+        return true;
+    }
+    flush_batch();
+    const uint32_t end_of_stream[2] = {0xFFFFFFFF, 0};
+    write_bytes(end_of_stream, sizeof(end_of_stream));
+
+    if (format_ == ARROW_FILE) {
+        // Footer table: version 0, schema 1, dictionaries 2, recordBatches 3
+        // Block struct: int64 offset, int32 metaDataLength, 4 bytes padding, int64 bodyLength
+        std::vector<uint8_t> blocks(blocks_.size() * 24, 0);
+        for (size_t i = 0; i < blocks_.size(); i++) {
+            memcpy(&blocks[i * 24], &blocks_[i].offset, 8);
+            memcpy(&blocks[i * 24 + 8], &blocks_[i].metadata_length, 4);
+            memcpy(&blocks[i * 24 + 16], &blocks_[i].body_length, 8);
+        }
+        FlatBuilder fb;
+        FbNode* footer = fb.table();
+        fb.scalar(footer, 0, 2, METADATA_V5);
+        fb.offset(footer, 1, frame_status_schema(&fb));
+        fb.offset(footer, 2, fb.structs(NULL, 0, 24));
+        fb.offset(footer, 3, fb.structs(blocks.empty() ? NULL : &blocks[0], blocks_.size(), 24));
+        std::vector<uint8_t> footer_bytes = fb.finish(footer);
+        const int32_t footer_length = static_cast<int32_t>(footer_bytes.size());
+        write_bytes(&footer_bytes[0], footer_bytes.size());
+        write_bytes(&footer_length, 4);
+        write_bytes(ARROW_MAGIC, sizeof(ARROW_MAGIC));
+    }
+
+    ok_ = fflush(file_) == 0 && ok_;
+    ok_ = fclose(file_) == 0 && ok_;
+    file_ = NULL;
+    return ok_;
+}
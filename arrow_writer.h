@@ -0,0 +1,53 @@
+#ifndef ARROW_WRITER_H
+#define ARROW_WRITER_H
+
+#include <cstdio>
+#include <stdint.h>
+#include "game_video.h"
+
+// Apache Arrow IPC writer for FrameStatus, without depending on the Arrow libraries.
+// Schema: ts int32, joystick_angle float64, spell1-3_cd, skill1-4_cd, money int32,
+//         hero_list list<struct<hero_id, x, y, level: int32>>, all non-nullable.
+// Rows are appended into column buffers and written as one record batch per batch_size rows.
+// Record batch bodies start 64-byte aligned in the file, so the file format can be mmap'd
+// and read zero-copy, e.g. pyarrow.ipc.open_file(pyarrow.memory_map(path)).
+class ArrowWriter {
+  public:
+    enum Format {
+        ARROW_FILE = 0,    // random access file format (.arrow)
+        ARROW_STREAM       // streaming format
+    };
+
+    ArrowWriter();
+    ~ArrowWriter();
+    bool open(const std::string& path, const Format& format = ARROW_FILE, const size_t& batch_size = 65536);
+    bool write(const FrameStatus&);
+    // flushes the pending batch and writes end of stream (and footer), false if any write failed
+    bool close();
+
+  private:
+    struct Block {
+        int64_t offset;
+        int32_t metadata_length;
+        int64_t body_length;
+    };
+
+    FILE* file_;
+    Format format_;
+    size_t batch_size_;
+    int64_t offset_;
+    bool ok_;
+    std::vector<Block> blocks_;
+
+    // column buffers of the pending batch
+    std::vector<int32_t> ints_[9];    // ts, cooldowns, money
+    std::vector<double> joystick_angle_;
+    std::vector<int32_t> hero_offsets_;
+    std::vector<int32_t> heroes_[4];    // hero_id, x, y, level
+
+    void write_bytes(const void*, const size_t&);
+    void write_message(const std::vector<uint8_t>& metadata, const std::vector<uint8_t>& body, Block* block);
+    bool flush_batch();
+};
+
+#endif
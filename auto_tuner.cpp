@@ -0,0 +1,178 @@
+#include <unistd.h>
+#include "auto_tuner.h"
+#include "thread_policy.h"
+
+static std::string host_name() {
+    char name[256] = {0};
+    if (gethostname(name, sizeof(name) - 1) != 0) {
+        return "localhost";
+    }
+    return name;
+}
+
+std::string default_profile_path() {
+    return "game_video." + host_name() + ".yml";
+}
+
+// better = higher fps within latency target, or lower latency if neither meets it
+static bool is_better(const BenchmarkResult& a, const BenchmarkResult& b, const double& latency_target_ms) {
+    bool a_ok = a.p99_ms <= latency_target_ms;
+    bool b_ok = b.p99_ms <= latency_target_ms;
+    if (a_ok != b_ok) {
+        return a_ok;
+    }
+    return a_ok ? a.fps > b.fps : a.p99_ms < b.p99_ms;
+}
+
+PipelineParams calibrate_pipeline(const NumberSamples& samples, const CalibrationOptions& options, BenchmarkResult* best_result) {
+    std::vector<std::vector<uchar> > encoded;
+    encode_synthetic_frames(samples, options.frame_size, options.frames, 0, &encoded);
+
+    std::vector<int> thread_candidates;
+    int cpus = thread_budget();
+    for (int n = 1; n < cpus; n *= 2) {
+        thread_candidates.push_back(n);
+    }
+    thread_candidates.push_back(cpus);
+    const int batch_candidates[] = {1, 2, 4, NUM_COOLDOWNS};
+    const int read_ahead_candidates[] = {0, 1, 2, 4, 8};
+
+    // tune one parameter at a time, starting from a parallel guess
+    PipelineParams best = {cpus, 1, 2};
+    *best_result = run_pipeline_benchmark(samples, encoded, best);
+    std::cout << "Threads\tBatch\tAhead\tFPS\tp99(ms)" << std::endl;
+    for (int dim = 0; dim < 3; dim++) {
+        std::vector<PipelineParams> candidates;
+        if (dim == 0) {
+            for (size_t i = 0; i < thread_candidates.size(); i++) {
+                PipelineParams p = best;
+                p.num_threads = thread_candidates[i];
+                candidates.push_back(p);
+            }
+        } else if (dim == 1) {
+            for (size_t i = 0; i < sizeof(batch_candidates) / sizeof(int); i++) {
+                PipelineParams p = best;
+                p.roi_batch = batch_candidates[i];
+                candidates.push_back(p);
+            }
+        } else {
+            for (size_t i = 0; i < sizeof(read_ahead_candidates) / sizeof(int); i++) {
+                PipelineParams p = best;
+                p.read_ahead = read_ahead_candidates[i];
+                candidates.push_back(p);
+            }
+        }
+        PipelineParams dim_best = best;
+        BenchmarkResult dim_best_result = *best_result;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            BenchmarkResult result = run_pipeline_benchmark(samples, encoded, candidates[i]);
+            std::cout << candidates[i].num_threads << '\t' << candidates[i].roi_batch << '\t' << candidates[i].read_ahead << '\t'
+                      << result.fps << '\t' << result.p99_ms << std::endl;
+            if (is_better(result, dim_best_result, options.latency_target_ms)) {
+                dim_best = candidates[i];
+                dim_best_result = result;
+            }
+        }
+        best = dim_best;
+        *best_result = dim_best_result;
+    }
+    return best;
+}
+
+bool load_pipeline_profile(const std::string& path, const cv::Size& frame_size, PipelineParams* params) {
+    cv::FileStorage fs;
+    try {
+        if (!fs.open(path, cv::FileStorage::READ)) {
+            return false;
+        }
+    } catch (const cv::Exception&) {
+        return false;
+    }
+    if (fs["num_threads"].empty() || fs["roi_batch"].empty() || fs["read_ahead"].empty() || fs["frame_width"].empty() || fs["frame_height"].empty()) {
+        std::cerr << "Incomplete pipeline profile " << path << std::endl;
+        return false;
+    }
+    std::string host;
+    fs["host"] >> host;
+    if (host != host_name()) {
+        std::cerr << "Pipeline profile " << path << " was calibrated on host " << host << ", ignored" << std::endl;
+        return false;
+    }
+    // the best parameters of 720p frames starve or oversubscribe the pool on 4K ones
+    cv::Size calibrated;
+    fs["frame_width"] >> calibrated.width;
+    fs["frame_height"] >> calibrated.height;
+    if (calibrated != frame_size) {
+        std::cerr << "Pipeline profile " << path << " was calibrated for " << calibrated.width << "x" << calibrated.height
+                  << " frames, input is " << frame_size.width << "x" << frame_size.height << ", ignored" << std::endl;
+        return false;
+    }
+    fs["num_threads"] >> params->num_threads;
+    fs["roi_batch"] >> params->roi_batch;
+    fs["read_ahead"] >> params->read_ahead;
+    return true;
+}
+
+bool save_pipeline_profile(const std::string& path, const PipelineParams& params, const CalibrationOptions& options, const BenchmarkResult& result) {
+    cv::FileStorage fs(path, cv::FileStorage::WRITE);
+    if (!fs.isOpened()) {
+        std::cerr << "Cannot write pipeline profile " << path << std::endl;
+        return false;
+    }
+    fs << "host" << host_name();
+    fs << "cpus" << cv::getNumberOfCPUs();
+    fs << "frame_width" << options.frame_size.width;
+    fs << "frame_height" << options.frame_size.height;
+    fs << "latency_target_ms" << options.latency_target_ms;
+    fs << "num_threads" << params.num_threads;
+    fs << "roi_batch" << params.roi_batch;
+    fs << "read_ahead" << params.read_ahead;
+    fs << "fps" << result.fps;
+    fs << "p99_ms" << result.p99_ms;
+    return true;
+}
+
+void print_pipeline_params(const PipelineParams& params) {
+    std::cout << "Pipeline: " << (params.num_threads < 0 ? thread_budget() : params.num_threads) << " thread(s), ROI batch " << params.roi_batch
+              << ", read ahead " << params.read_ahead << " frame(s)" << std::endl;
+}
+
+int run_calibration(int argc, char** argv) {
+    CalibrationOptions options = DEFAULT_CALIBRATION_OPTIONS;
+    std::string profile = default_profile_path();
+    std::string samples_folder = "../samples";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--calibrate") {
+            continue;
+        } else if (arg == "--profile" && has_value) {
+            profile = argv[++i];
+        } else if (arg == "--size" && has_value && parse_frame_size(argv[i + 1], &options.frame_size)) {
+            i++;
+        } else if (arg == "--frames" && has_value) {
+            options.frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--latency-target" && has_value) {
+            options.latency_target_ms = std::atof(argv[++i]);
+        } else if (arg == "--samples" && has_value) {
+            samples_folder = argv[++i];
+        } else {
+            std::cerr << "Unknown calibration option " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    NumberSamples samples;
+    if (!load_number_samples(samples_folder, &samples)) {
+        return -1;
+    }
+    BenchmarkResult result;
+    PipelineParams params = calibrate_pipeline(samples, options, &result);
+    print_pipeline_params(params);
+    print_benchmark_result(result);
+    if (!save_pipeline_profile(profile, params, options, result)) {
+        return -1;
+    }
+    std::cout << "Saved pipeline profile " << profile << std::endl;
+    return 0;
+}
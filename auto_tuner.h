@@ -0,0 +1,33 @@
+#ifndef AUTO_TUNER_H
+#define AUTO_TUNER_H
+
+#include "game_video.h"
+#include "benchmark.h"
+
+// Startup calibration of host dependent pipeline parameters.
+// Runs the pipeline benchmark on synthetic frames of the input resolution for a few candidate
+// parameter sets, picks the one with the highest fps whose p99 latency stays within target,
+// and persists it into a per-host profile file, which only applies to frames of that resolution.
+
+struct CalibrationOptions {
+    cv::Size frame_size;         // resolution of the input video
+    size_t frames;               // frames per candidate run
+    double latency_target_ms;    // p99 per frame latency target
+};
+
+const CalibrationOptions DEFAULT_CALIBRATION_OPTIONS = {cv::Size(1280, 720), 30, 100.0};
+
+PipelineParams calibrate_pipeline(const NumberSamples&, const CalibrationOptions&, BenchmarkResult* best_result);
+
+// game_video.<hostname>.yml in working directory, so hosts sharing a folder keep separate profiles
+std::string default_profile_path();
+// false, params untouched, when the profile is missing, was calibrated on another host or for
+// frames of another size than frame_size
+bool load_pipeline_profile(const std::string& path, const cv::Size& frame_size, PipelineParams*);
+bool save_pipeline_profile(const std::string& path, const PipelineParams&, const CalibrationOptions&, const BenchmarkResult&);
+void print_pipeline_params(const PipelineParams&);
+
+// usage: game_video --calibrate [--profile file] [--size 1280x720] [--frames 30] [--latency-target 100] [--samples ../samples]
+int run_calibration(int argc, char** argv);
+
+#endif
@@ -0,0 +1,523 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "benchmark.h"
+#include "alloc_counter.h"
+#include "auto_tuner.h"
+#include "frame_reader.h"
+#include "synthetic_frames.h"
+
+void encode_synthetic_frames(const NumberSamples& samples, const cv::Size& size, const size_t& count, const unsigned& seed, std::vector<std::vector<uchar> >* encoded, const int& repeat) {
+    SyntheticFrameGenerator generator(samples, 30, seed);
+    encoded->resize(count);
+    cv::Mat frame;
+    for (size_t i = 0; i < count; i++) {
+        int ts;
+        if (i % std::max(1, repeat) == 0) {
+            generator.next(&frame, &ts);
+            if (frame.size() != size) {
+                cv::resize(frame, frame, size, 0, 0, cv::INTER_LINEAR);
+            }
+        }
+        // repeats differ by encoder noise only
+        std::vector<int> params(2);
+        params[0] = cv::IMWRITE_JPEG_QUALITY;
+        params[1] = 95 - 3 * static_cast<int>(i % std::max(1, repeat));
+        cv::imencode(".jpg", frame, (*encoded)[i], params);
+    }
+}
+
+BenchmarkResult run_pipeline_benchmark(const NumberSamples& samples, const std::vector<std::vector<uchar> >& encoded, const PipelineParams& params, GlyphBankStats* glyph_stats,
+                                       const int& dedup_tolerance, SlowFrameTracker* slow_frames, const double& level_deadline_ms,
+                                       const bool& coarse_levels, const bool& badge_prefilter) {
+    GameVideoAnalyzer game_video_analyzer;
+    game_video_analyzer.set_display(false);
+    game_video_analyzer.set_glyph_adaptation(glyph_stats != NULL);
+    game_video_analyzer.set_dedup_tolerance(dedup_tolerance);
+    game_video_analyzer.set_level_deadline(level_deadline_ms);
+    game_video_analyzer.set_coarse_level_discovery(coarse_levels);
+    game_video_analyzer.set_level_badge_prefilter(badge_prefilter);
+    apply_pipeline_params(params, &game_video_analyzer);
+
+    FrameReader reader([&encoded](const size_t& index, cv::Mat* frame) {
+        *frame = cv::imdecode(encoded[index], cv::IMREAD_COLOR);
+        return !frame->empty();
+    }, 0, encoded.size(), params.read_ahead);
+
+    // the first frames warm up caches and allocations, they are not counted
+    const size_t warm_up = std::min<size_t>(2, encoded.size() / 10);
+    BenchmarkResult result;
+    std::fill(result.stage_ms, result.stage_ms + STAGE_COUNT, 0.0);
+    result.deferred_frames = 0;
+    std::vector<double> frame_ms;
+    int64 start = cv::getTickCount();
+    cv::Mat frame;
+    size_t index;
+    while (true) {
+        int64 tick = cv::getTickCount();
+        if (!reader.read(&frame, &index)) {
+            break;
+        }
+        double stage_ms[STAGE_COUNT];
+        FrameStatus status;
+        if (slow_frames) {
+            slow_frames->before_frame(frame);
+        }
+        game_video_analyzer.adjust_size(&frame);
+        game_video_analyzer.process_frame(&frame, static_cast<int>(index) * 33, samples, &status, stage_ms);
+        game_video_analyzer.update_frame_status(status);
+        if (index < warm_up) {
+            start = cv::getTickCount();
+            continue;
+        }
+        frame_ms.push_back((cv::getTickCount() - tick) * 1000.0 / cv::getTickFrequency());
+        if (slow_frames) {
+            slow_frames->add(index, status.ts, frame_ms.back(), stage_ms, game_video_analyzer.stream());
+        }
+        for (size_t s = 0; s < STAGE_COUNT; s++) {
+            result.stage_ms[s] += stage_ms[s];
+        }
+        if (!game_video_analyzer.stream().deferred_regions.empty()) {
+            result.deferred_frames++;
+        }
+    }
+    double elapsed = (cv::getTickCount() - start) / cv::getTickFrequency();
+
+    result.frames = frame_ms.size();
+    result.fps = result.frames / std::max(1e-6, elapsed);
+    std::sort(frame_ms.begin(), frame_ms.end());
+    result.p50_ms = frame_ms.empty() ? 0 : frame_ms[frame_ms.size() / 2];
+    result.p99_ms = frame_ms.empty() ? 0 : frame_ms[std::min(frame_ms.size() - 1, frame_ms.size() * 99 / 100)];
+    for (size_t s = 0; s < STAGE_COUNT; s++) {
+        result.stage_ms[s] /= std::max<size_t>(1, result.frames);
+    }
+    if (glyph_stats) {
+        *glyph_stats = game_video_analyzer.glyph_bank_stats();
+    }
+    result.duplicate_frames = game_video_analyzer.duplicate_frames();
+    return result;
+}
+
+void print_benchmark_result(const BenchmarkResult& result) {
+    std::cout << result.frames << " frames, " << result.fps << " fps, p50 " << result.p50_ms << "ms, p99 " << result.p99_ms << "ms" << std::endl;
+    if (result.duplicate_frames > 0) {
+        std::cout << "    " << result.duplicate_frames << " duplicate frames reused the previous status" << std::endl;
+    }
+    if (result.deferred_frames > 0) {
+        std::cout << "    " << result.deferred_frames << " frames deferred level regions at the deadline" << std::endl;
+    }
+    for (size_t s = 0; s < STAGE_COUNT; s++) {
+        std::cout << "    " << frame_stage_name(s) << " mean " << result.stage_ms[s] << "ms" << std::endl;
+    }
+}
+
+extern char** environ;
+
+// one fresh process: spawns it and collects the startup phases it prints, in ms from the spawn
+static bool run_cold_start_child(const std::string& exe, const std::vector<std::string>& args, std::vector<std::pair<std::string, double> >* phases) {
+    int out[2];
+    if (pipe(out) != 0) {
+        return false;
+    }
+    std::vector<char*> child_argv;
+    child_argv.push_back(const_cast<char*>(exe.c_str()));
+    for (size_t i = 0; i < args.size(); i++) {
+        child_argv.push_back(const_cast<char*>(args[i].c_str()));
+    }
+    child_argv.push_back(NULL);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, out[0]);
+
+    pid_t pid;
+    const int64_t spawn_ns = startup_clock_ns();
+    int spawned = posix_spawn(&pid, exe.c_str(), &actions, NULL, &child_argv[0], environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(out[1]);
+    if (spawned != 0) {
+        close(out[0]);
+        return false;
+    }
+
+    // "startup\t<phase>\t<end ns>" lines among the child's regular output
+    phases->clear();
+    FILE* child_out = fdopen(out[0], "r");
+    char line[512];
+    while (fgets(line, sizeof(line), child_out)) {
+        char name[256];
+        long long end_ns;
+        if (sscanf(line, "startup\t%255[^\t]\t%lld", name, &end_ns) == 2) {
+            phases->push_back(std::make_pair(std::string(name), (end_ns - spawn_ns) / 1e6));
+        }
+    }
+    fclose(child_out);
+    int status;
+    return waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 && !phases->empty();
+}
+
+bool run_cold_start_benchmark(const std::vector<uchar>& encoded_frame, const std::string& profile, const std::string& samples_folder, const int& runs) {
+    char exe[4096];
+    ssize_t length = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (length <= 0) {
+        std::cerr << "Cannot locate the executable" << std::endl;
+        return false;
+    }
+    exe[length] = '\0';
+    char frame_path[] = "/tmp/game_video_cold_start_XXXXXX";
+    int fd = mkstemp(frame_path);
+    if (fd < 0 || write(fd, &encoded_frame[0], encoded_frame.size()) != static_cast<ssize_t>(encoded_frame.size())) {
+        std::cerr << "Cannot write the cold start frame" << std::endl;
+        if (fd >= 0) {
+            close(fd);
+            unlink(frame_path);
+        }
+        return false;
+    }
+    close(fd);
+
+    std::vector<std::string> args;
+    args.push_back("--first-status");
+    args.push_back(frame_path);
+    args.push_back("--profile");
+    args.push_back(profile);
+    args.push_back("--samples");
+    args.push_back(samples_folder);
+    // the child looks the profile up for the frame's resolution
+    const cv::Size size = cv::imdecode(encoded_frame, cv::IMREAD_COLOR).size();
+    args.push_back("--size");
+    args.push_back(std::to_string(size.width) + "x" + std::to_string(size.height));
+
+    // durations per phase, phases in the order of the first run
+    std::vector<std::string> names;
+    std::map<std::string, std::vector<double> > durations;
+    bool ok = true;
+    for (int r = 0; r < runs && ok; r++) {
+        std::vector<std::pair<std::string, double> > phases;
+        ok = run_cold_start_child(exe, args, &phases);
+        double last = 0;
+        for (size_t i = 0; i < phases.size() && ok; i++) {
+            const std::string name = phases[i].first == "start" ? "exec" : phases[i].first;
+            if (r == 0) {
+                names.push_back(name);
+            }
+            durations[name].push_back(phases[i].second - last);
+            last = phases[i].second;
+        }
+    }
+    unlink(frame_path);
+    if (!ok) {
+        std::cerr << "Cold start run failed" << std::endl;
+        return false;
+    }
+
+    std::cout << "Cold start over " << runs << " processes, median (worst) per phase:" << std::endl;
+    double first_status_ms = 0;
+    bool before_first_status = true;
+    for (size_t i = 0; i < names.size(); i++) {
+        std::vector<double>& phase = durations[names[i]];
+        std::sort(phase.begin(), phase.end());
+        double median = phase[phase.size() / 2];
+        std::cout << "    " << names[i] << ' ' << median << "ms (" << phase.back() << "ms)" << std::endl;
+        if (before_first_status) {
+            first_status_ms += median;
+        }
+        before_first_status = before_first_status && names[i] != "first status";
+    }
+    std::cout << "    time to first status " << first_status_ms << "ms" << std::endl;
+    return true;
+}
+
+int run_first_status(int argc, char** argv, StartupProfile* startup) {
+    if (argc < 3) {
+        std::cerr << "usage: game_video --first-status <frame file> [--profile file] [--samples ../samples] [--size 1280x720]" << std::endl;
+        return -1;
+    }
+    cv::Size size(1280, 720);
+    std::string profile = default_profile_path();
+    std::string samples_folder = "../samples";
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--profile" && has_value) {
+            profile = argv[++i];
+        } else if (arg == "--samples" && has_value) {
+            samples_folder = argv[++i];
+        } else if (arg == "--size" && has_value && parse_frame_size(argv[i + 1], &size)) {
+            i++;
+        } else {
+            std::cerr << "Unknown first status option " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    // the startup of a batch worker: samples, profile, threads, then frames
+    NumberSamples samples;
+    if (!load_number_samples(samples_folder, &samples)) {
+        return -1;
+    }
+    startup->mark("samples");
+    PipelineParams params = DEFAULT_PIPELINE_PARAMS;
+    load_pipeline_profile(profile, size, &params);
+    GameVideoAnalyzer game_video_analyzer;
+    game_video_analyzer.set_display(false);
+    startup->mark("analyzer");
+    apply_pipeline_params(params, &game_video_analyzer);
+    startup->mark("parallel backend");
+
+    const char* phases[2][2] = {{"first decode", "first status"}, {"second decode", "second status"}};
+    for (int k = 0; k < 2; k++) {
+        cv::Mat frame = cv::imread(argv[2]);
+        if (frame.empty()) {
+            std::cerr << "Cannot read " << argv[2] << std::endl;
+            return -1;
+        }
+        game_video_analyzer.adjust_size(&frame);
+        startup->mark(phases[k][0]);
+        FrameStatus status;
+        game_video_analyzer.process_frame(&frame, 0, samples, &status);
+        startup->mark(phases[k][1]);
+    }
+    startup->print_raw(std::cout);
+    return 0;
+}
+
+int run_alloc_check(int argc, char** argv) {
+    size_t frames = 100;
+    size_t warmup = 30;
+    double budget = 0;
+    size_t top_sites = 10;
+    cv::Size size(1280, 720);
+    std::string profile = default_profile_path();
+    std::string samples_folder = "../samples";
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--frames" && has_value) {
+            frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && has_value) {
+            warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--budget" && has_value) {
+            budget = std::atof(argv[++i]);
+        } else if (arg == "--sites" && has_value) {
+            top_sites = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--size" && has_value && parse_frame_size(argv[i + 1], &size)) {
+            i++;
+        } else if (arg == "--profile" && has_value) {
+            profile = argv[++i];
+        } else if (arg == "--samples" && has_value) {
+            samples_folder = argv[++i];
+        } else {
+            std::cerr << "Unknown allocation check option " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (!allocation_hook_installed()) {
+        std::cerr << "Allocation counting needs a build configured with -DGAME_VIDEO_ALLOC_HOOK=ON" << std::endl;
+        return -1;
+    }
+
+    NumberSamples samples;
+    if (!load_number_samples(samples_folder, &samples)) {
+        return -1;
+    }
+    PipelineParams params = DEFAULT_PIPELINE_PARAMS;
+    load_pipeline_profile(profile, size, &params);
+    std::vector<std::vector<uchar> > encoded;
+    encode_synthetic_frames(samples, size, warmup + frames, 0, &encoded);
+    // decoded up front, only the analysis is counted
+    std::vector<cv::Mat> decoded(encoded.size());
+    for (size_t i = 0; i < encoded.size(); i++) {
+        decoded[i] = cv::imdecode(encoded[i], cv::IMREAD_COLOR);
+    }
+
+    GameVideoAnalyzer game_video_analyzer;
+    game_video_analyzer.set_display(false);
+    apply_pipeline_params(params, &game_video_analyzer);
+    cv::Mat frame;
+    FrameStatus status;
+    size_t max_frame_allocations = 0;
+    for (size_t i = 0; i < decoded.size(); i++) {
+        if (i == warmup) {
+            start_allocation_count(top_sites > 0);
+        }
+        const size_t before = i >= warmup ? counted_allocations() : 0;
+        // the analysis draws on the frame, a copy into the same buffer does not allocate
+        decoded[i].copyTo(frame);
+        game_video_analyzer.adjust_size(&frame);
+        game_video_analyzer.process_frame(&frame, static_cast<int>(i) * 33, samples, &status);
+        if (i >= warmup) {
+            max_frame_allocations = std::max(max_frame_allocations, counted_allocations() - before);
+        }
+    }
+    AllocationStats stats = stop_allocation_count();
+    std::vector<AllocationSite> sites;
+    allocation_sites(top_sites, &sites);
+
+    // HoughCircles allocates its accumulator and edge buffers inside OpenCV on every call; they are
+    // measured on the same frames and left out of the budget, which covers the rest of the analysis
+    start_allocation_count(false);
+    for (size_t i = warmup; i < decoded.size(); i++) {
+        decoded[i].copyTo(frame);
+        game_video_analyzer.adjust_size(&frame);
+        game_video_analyzer.estimate_joystick_angle(&frame);
+    }
+    const size_t hough_allocations = stop_allocation_count().allocations;
+    const size_t budgeted = stats.allocations - std::min(stats.allocations, hough_allocations);
+
+    std::cout << stats.allocations << " allocations (" << static_cast<double>(stats.allocations) / frames << " per frame, at most "
+              << max_frame_allocations << "), " << stats.bytes << " bytes and " << stats.frees << " frees in " << frames
+              << " frames after " << warmup << " warm-up frames, " << hough_allocations << " of them in the joystick's HoughCircles" << std::endl;
+    for (size_t i = 0; i < sites.size(); i++) {
+        std::cout << sites[i].allocations << " allocations, " << sites[i].bytes << " bytes at" << std::endl;
+        for (size_t f = 0; f < sites[i].frames.size(); f++) {
+            std::cout << "    " << sites[i].frames[f] << std::endl;
+        }
+    }
+    if (stats.dropped_sites > 0) {
+        std::cout << stats.dropped_sites << " allocations not attributed, the site table is full" << std::endl;
+    }
+    bool passed = budgeted <= budget * frames;
+    std::cout << (passed ? "PASS" : "FAIL") << ": " << static_cast<double>(budgeted) / frames << " allocations per frame besides HoughCircles, budget "
+              << budget << std::endl;
+    return passed ? 0 : 1;
+}
+
+bool load_encoded_frames(const std::string& folder, std::vector<std::vector<uchar> >* encoded) {
+    std::vector<cv::String> filenames;
+    cv::glob(folder, filenames);
+    encoded->clear();
+    for (size_t i = 0; i < filenames.size(); i++) {
+        FILE* file = fopen(filenames[i].c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        std::vector<uchar> data;
+        uchar block[1 << 16];
+        size_t n;
+        while ((n = fread(block, 1, sizeof(block), file)) > 0) {
+            data.insert(data.end(), block, block + n);
+        }
+        fclose(file);
+        encoded->push_back(data);
+    }
+    return !encoded->empty();
+}
+
+bool parse_frame_size(const std::string& text, cv::Size* size) {
+    size_t x = text.find('x');
+    if (x == std::string::npos) {
+        return false;
+    }
+    size->width = std::atoi(text.substr(0, x).c_str());
+    size->height = std::atoi(text.substr(x + 1).c_str());
+    return size->width > 0 && size->height > 0;
+}
+
+int run_benchmark(int argc, char** argv) {
+    size_t frames = 100;
+    cv::Size size(1280, 720);
+    std::string profile = default_profile_path();
+    std::string samples_folder = "../samples";
+    bool adapt_glyphs = false;
+    int upsample = 1;
+    int dedup_tolerance = -1;
+    int cold_start_runs = 0;
+    size_t slow_frame_count = 0;
+    std::string dump_folder;
+    std::string replay_folder;
+    double level_deadline_ms = 0;
+    bool coarse_levels = false;
+    bool badge_prefilter = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--benchmark") {
+            continue;
+        } else if (arg == "--frames" && has_value) {
+            frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--size" && has_value && parse_frame_size(argv[i + 1], &size)) {
+            i++;
+        } else if (arg == "--profile" && has_value) {
+            profile = argv[++i];
+        } else if (arg == "--samples" && has_value) {
+            samples_folder = argv[++i];
+        } else if (arg == "--adapt-glyphs") {
+            adapt_glyphs = true;
+        } else if (arg == "--upsample" && has_value) {
+            upsample = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--dedup") {
+            dedup_tolerance = has_value && argv[i + 1][0] != '-' ? std::atoi(argv[++i]) : DEFAULT_DEDUP_TOLERANCE;
+        } else if (arg == "--cold-start") {
+            cold_start_runs = has_value && argv[i + 1][0] != '-' ? std::max(1, std::atoi(argv[++i])) : 5;
+        } else if (arg == "--slow-frames" && has_value) {
+            slow_frame_count = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--dump-slow" && has_value) {
+            dump_folder = argv[++i];
+        } else if (arg == "--replay" && has_value) {
+            replay_folder = argv[++i];
+        } else if (arg == "--level-deadline" && has_value) {
+            level_deadline_ms = std::atof(argv[++i]);
+        } else if (arg == "--coarse-levels") {
+            coarse_levels = true;
+        } else if (arg == "--badge-prefilter") {
+            badge_prefilter = true;
+        } else {
+            std::cerr << "Unknown benchmark option " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    NumberSamples samples;
+    if (!load_number_samples(samples_folder, &samples)) {
+        return -1;
+    }
+    std::vector<std::vector<uchar> > encoded;
+    // the profile is looked up for the benchmarked resolution, of the first frame when replaying
+    cv::Size frame_size = size;
+    size_t replayed = 0;
+    if (!replay_folder.empty()) {
+        std::vector<std::vector<uchar> > images;
+        if (!load_encoded_frames(replay_folder, &images)) {
+            std::cerr << "No frames to replay in " << replay_folder << std::endl;
+            return -1;
+        }
+        for (size_t i = 0; i < std::max(frames, images.size()); i++) {
+            encoded.push_back(images[i % images.size()]);
+        }
+        frame_size = cv::imdecode(images[0], cv::IMREAD_COLOR).size();
+        replayed = images.size();
+    } else {
+        encode_synthetic_frames(samples, size, frames, 0, &encoded, upsample);
+    }
+    PipelineParams params = DEFAULT_PIPELINE_PARAMS;
+    if (load_pipeline_profile(profile, frame_size, &params)) {
+        std::cout << "Using pipeline profile " << profile << std::endl;
+    }
+    print_pipeline_params(params);
+    if (replayed > 0) {
+        std::cout << "Replaying " << replayed << " frames of " << replay_folder << ": ";
+    } else {
+        std::cout << "Pipeline benchmark at " << size.width << "x" << size.height << ": ";
+    }
+    if (!dump_folder.empty()) {
+        slow_frame_count = slow_frame_count > 0 ? slow_frame_count : 10;
+    }
+    SlowFrameTracker slow_frames(slow_frame_count, dump_folder);
+    GlyphBankStats glyph_stats;
+    print_benchmark_result(run_pipeline_benchmark(samples, encoded, params, adapt_glyphs ? &glyph_stats : NULL, dedup_tolerance,
+                                                  slow_frames.enabled() ? &slow_frames : NULL, level_deadline_ms, coarse_levels,
+                                                  badge_prefilter));
+    slow_frames.print(std::cout);
+    if (adapt_glyphs) {
+        std::cout << "Glyph bank: " << glyph_stats.variants << " variants, " << glyph_stats.learned << " learned, "
+                  << glyph_stats.hits << " of " << glyph_stats.lookups << " lookups matched a variant" << std::endl;
+    }
+    if (cold_start_runs > 0 && !encoded.empty() && !run_cold_start_benchmark(encoded[0], profile, samples_folder, cold_start_runs)) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "game_video.h"
+#include "slow_frames.h"
+#include "startup_profile.h"
+
+// statistics of one benchmark run
+struct BenchmarkResult {
+    size_t frames;
+    double fps;
+    double p50_ms;    // per frame latency, waiting for decode included
+    double p99_ms;
+    double stage_ms[STAGE_COUNT];    // mean per stage
+    size_t duplicate_frames;         // frames that reused the status of a duplicate
+    size_t deferred_frames;          // frames whose level search stopped at the deadline
+};
+
+// renders synthetic frames at the given resolution and keeps them jpeg encoded,
+// so that benchmarks also pay the decoding cost of recorded frames;
+// repeat > 1 encodes each frame that many times at slightly different quality, like a 30 fps
+// source re-encoded at a multiple of its frame rate
+void encode_synthetic_frames(const NumberSamples&, const cv::Size&, const size_t& count, const unsigned& seed, std::vector<std::vector<uchar> >*, const int& repeat = 1);
+
+// decodes and analyzes encoded frames with the given pipeline parameters,
+// with glyph adaptation when glyph_stats is given, which then receives the glyph bank statistics,
+// duplicate frame detection when dedup_tolerance >= 0, slow_frames (optional) receives the slowest frames,
+// the level search is anytime when level_deadline_ms > 0, starts from coarse_levels discovery when set
+// and reads only icons inside a badge ring with badge_prefilter
+BenchmarkResult run_pipeline_benchmark(const NumberSamples&, const std::vector<std::vector<uchar> >&, const PipelineParams&, GlyphBankStats* glyph_stats = NULL,
+                                       const int& dedup_tolerance = -1, SlowFrameTracker* slow_frames = NULL, const double& level_deadline_ms = 0,
+                                       const bool& coarse_levels = false, const bool& badge_prefilter = false);
+
+// reads the frames dumped by --dump-slow, or any images of a folder, still encoded
+bool load_encoded_frames(const std::string& folder, std::vector<std::vector<uchar> >*);
+
+void print_benchmark_result(const BenchmarkResult&);
+
+// starts runs fresh processes that analyze the encoded frame with --first-status and prints the median
+// and worst duration of each startup phase, "exec" being the spawn up to the child's static initialization
+bool run_cold_start_benchmark(const std::vector<uchar>& encoded_frame, const std::string& profile, const std::string& samples_folder, const int& runs);
+
+// usage: game_video --benchmark [--frames 100] [--size 1280x720] [--profile file] [--samples ../samples] [--adapt-glyphs]
+//        [--upsample N] [--dedup [tolerance]] [--cold-start [runs]] [--slow-frames 10] [--dump-slow folder]
+//        [--replay folder] [--level-deadline ms] [--coarse-levels]
+//        [--badge-prefilter]
+// --replay benchmarks the images of a folder, e.g. dumped slow frames, cycled to --frames
+int run_benchmark(int argc, char** argv);
+
+// usage: game_video --alloc-check [--frames 100] [--warmup 30] [--budget 0] [--sites 10] [--size 1280x720] [--profile file]
+//        [--samples ../samples]
+// analyzes synthetic frames after a warm-up and fails when the steady state allocates more than
+// budget times per frame besides the joystick's HoughCircles, which is measured on the same frames
+// and reported apart; lists the call sites that allocated, needs -DGAME_VIDEO_ALLOC_HOOK=ON
+int run_alloc_check(int argc, char** argv);
+
+// usage: game_video --first-status <frame file> [--profile file] [--samples ../samples] [--size 1280x720]
+// child process of the cold start benchmark: analyzes the frame twice, then prints the startup phases;
+// --size is the frame's resolution, the profile is loaded before the frame is decoded
+int run_first_status(int argc, char** argv, StartupProfile* startup);
+
+// parses "<width>x<height>"
+bool parse_frame_size(const std::string&, cv::Size*);
+
+#endif
@@ -0,0 +1,565 @@
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "column_store.h"
+
+static const char COLUMN_MAGIC[4] = {'G', 'V', 'C', '1'};
+static const char FOOTER_MAGIC[4] = {'G', 'V', 'C', 'I'};
+static const size_t FOOTER_TAIL_SIZE = 8 + 4;
+
+// column chunk encodings, ENC_DEFLATE is or'ed in when zlib made the chunk smaller
+static const uint8_t ENC_RLE = 0;      // {zigzag varint value, varint run length}*
+static const uint8_t ENC_DELTA = 1;    // zigzag varint difference to the previous value, starting at 0
+static const uint8_t ENC_DEFLATE = 0x80;
+
+static const char* COLUMN_NAMES[COL_COUNT] = {"ts", "joystick_angle", "spell1_cd", "spell2_cd", "spell3_cd", "skill1_cd", "skill2_cd",
+                                              "skill3_cd", "skill4_cd", "money", "hero_count", "hero_id", "hero_x", "hero_y", "hero_level"};
+
+template <typename T>
+static inline void put(std::vector<char>* buffer, const T& value) {
+    const char* p = reinterpret_cast<const char*>(&value);
+    buffer->insert(buffer->end(), p, p + sizeof(T));
+}
+
+template <typename T>
+static inline T get(const char** p) {
+    T value;
+    memcpy(&value, *p, sizeof(T));
+    *p += sizeof(T);
+    return value;
+}
+
+static inline uint64_t zigzag(const int64_t& v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+static inline int64_t unzigzag(const uint64_t& v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+static inline void put_varint(std::vector<char>* buffer, uint64_t v) {
+    while (v >= 0x80) {
+        buffer->push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    buffer->push_back(static_cast<char>(v));
+}
+
+// false past end
+static inline bool get_varint(const unsigned char** p, const unsigned char* end, uint64_t* v) {
+    *v = 0;
+    for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+        unsigned char byte = *(*p)++;
+        *v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline double column_value(const int& column, const int64_t& stored) {
+    if (column == COL_JOYSTICK_ANGLE) {
+        double value;
+        memcpy(&value, &stored, sizeof(value));
+        return value;
+    }
+    return static_cast<double>(stored);
+}
+
+// smaller of runs and deltas; deltas of a float bit pattern mean nothing, so angles use runs only
+static uint8_t encode_column(const std::vector<int64_t>& values, const bool& allow_delta, std::vector<char>* encoded) {
+    encoded->clear();
+    for (size_t i = 0; i < values.size();) {
+        size_t run = 1;
+        while (i + run < values.size() && values[i + run] == values[i]) {
+            run++;
+        }
+        put_varint(encoded, zigzag(values[i]));
+        put_varint(encoded, run);
+        i += run;
+    }
+    if (!allow_delta) {
+        return ENC_RLE;
+    }
+    std::vector<char> delta;
+    int64_t previous = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        put_varint(&delta, zigzag(values[i] - previous));
+        previous = values[i];
+    }
+    if (delta.size() < encoded->size()) {
+        encoded->swap(delta);
+        return ENC_DELTA;
+    }
+    return ENC_RLE;
+}
+
+static bool decode_column(const unsigned char* p, const unsigned char* end, const uint8_t& encoding, const size_t& count, std::vector<int64_t>* values) {
+    values->clear();
+    values->reserve(count);
+    uint64_t v;
+    if (encoding == ENC_RLE) {
+        while (values->size() < count) {
+            uint64_t run;
+            if (!get_varint(&p, end, &v) || !get_varint(&p, end, &run) || run > count - values->size()) {
+                return false;
+            }
+            values->insert(values->end(), run, unzigzag(v));
+        }
+        return true;
+    }
+    if (encoding == ENC_DELTA) {
+        int64_t previous = 0;
+        while (values->size() < count) {
+            if (!get_varint(&p, end, &v)) {
+                return false;
+            }
+            previous += unzigzag(v);
+            values->push_back(previous);
+        }
+        return true;
+    }
+    return false;
+}
+
+const char* result_column_name(const int& column) {
+    return column >= 0 && column < COL_COUNT ? COLUMN_NAMES[column] : "unknown";
+}
+
+int parse_result_column(const std::string& name) {
+    int column = 0;
+    while (column < COL_COUNT && name != COLUMN_NAMES[column]) {
+        column++;
+    }
+    return column;
+}
+
+ColumnWriter::ColumnWriter() : file_(NULL), offset_(0), chunk_frames_(4096), ok_(false) {}
+
+ColumnWriter::~ColumnWriter() {
+    close();
+}
+
+bool ColumnWriter::open(const std::string& path, const size_t& chunk_frames) {
+    close();
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    chunk_frames_ = std::max<size_t>(1, chunk_frames);
+    chunks_.clear();
+    for (int c = 0; c < COL_COUNT; c++) {
+        values_[c].clear();
+    }
+    ok_ = fwrite(COLUMN_MAGIC, 1, sizeof(COLUMN_MAGIC), file_) == sizeof(COLUMN_MAGIC);
+    offset_ = sizeof(COLUMN_MAGIC);
+    return ok_;
+}
+
+bool ColumnWriter::write(const FrameStatus& status) {
+    int64_t angle_bits;
+    memcpy(&angle_bits, &status.joystick_angle, sizeof(angle_bits));
+    values_[COL_TS].push_back(status.ts);
+    values_[COL_JOYSTICK_ANGLE].push_back(angle_bits);
+    values_[COL_SPELL1_CD].push_back(status.spell1_cd);
+    values_[COL_SPELL2_CD].push_back(status.spell2_cd);
+    values_[COL_SPELL3_CD].push_back(status.spell3_cd);
+    values_[COL_SKILL1_CD].push_back(status.skill1_cd);
+    values_[COL_SKILL2_CD].push_back(status.skill2_cd);
+    values_[COL_SKILL3_CD].push_back(status.skill3_cd);
+    values_[COL_SKILL4_CD].push_back(status.skill4_cd);
+    values_[COL_MONEY].push_back(status.money);
+    values_[COL_HERO_COUNT].push_back(status.hero_list.size());
+    for (size_t i = 0; i < status.hero_list.size(); i++) {
+        values_[COL_HERO_ID].push_back(status.hero_list[i].hero_id);
+        values_[COL_HERO_X].push_back(status.hero_list[i].position.x);
+        values_[COL_HERO_Y].push_back(status.hero_list[i].position.y);
+        values_[COL_HERO_LEVEL].push_back(status.hero_list[i].level);
+    }
+    if (values_[COL_TS].size() >= chunk_frames_) {
+        flush_chunk();
+    }
+    return ok_;
+}
+
+void ColumnWriter::flush_chunk() {
+    if (values_[COL_TS].empty() || !file_) {
+        return;
+    }
+    ChunkInfo chunk;
+    chunk.frames = values_[COL_TS].size();
+    chunk.heroes = values_[COL_HERO_ID].size();
+    for (int c = 0; c < COL_COUNT; c++) {
+        const std::vector<int64_t>& values = values_[c];
+        ColumnChunk& column = chunk.columns[c];
+        column.zone.min = 0;
+        column.zone.max = 0;
+        column.zone.any_nonzero = false;
+        for (size_t i = 0; i < values.size(); i++) {
+            double value = column_value(c, values[i]);
+            column.zone.min = i == 0 ? value : std::min(column.zone.min, value);
+            column.zone.max = i == 0 ? value : std::max(column.zone.max, value);
+            column.zone.any_nonzero = column.zone.any_nonzero || value != 0;
+        }
+
+        column.encoding = encode_column(values, c != COL_JOYSTICK_ANGLE, &encoded_);
+        column.raw_size = encoded_.size();
+        const char* stored = encoded_.empty() ? NULL : &encoded_[0];
+        column.stored_size = encoded_.size();
+        uLongf compressed_size = compressBound(encoded_.size());
+        compressed_.resize(compressed_size);
+        if (!encoded_.empty() &&
+            compress2(&compressed_[0], &compressed_size, reinterpret_cast<const Bytef*>(&encoded_[0]), encoded_.size(), Z_DEFAULT_COMPRESSION) == Z_OK &&
+            compressed_size < encoded_.size()) {
+            column.encoding |= ENC_DEFLATE;
+            stored = reinterpret_cast<const char*>(&compressed_[0]);
+            column.stored_size = compressed_size;
+        }
+        column.offset = offset_;
+        if (column.stored_size > 0 && fwrite(stored, 1, column.stored_size, file_) != column.stored_size) {
+            ok_ = false;
+        }
+        offset_ += column.stored_size;
+        values_[c].clear();
+    }
+    chunks_.push_back(chunk);
+}
+
+bool ColumnWriter::close() {
+    if (!file_) {
+        return true;
+    }
+    flush_chunk();
+    std::vector<char> footer;
+    put<uint32_t>(&footer, COL_COUNT);
+    put<uint32_t>(&footer, static_cast<uint32_t>(chunk_frames_));
+    put<uint32_t>(&footer, static_cast<uint32_t>(chunks_.size()));
+    for (size_t i = 0; i < chunks_.size(); i++) {
+        put<uint32_t>(&footer, chunks_[i].frames);
+        put<uint32_t>(&footer, chunks_[i].heroes);
+        for (int c = 0; c < COL_COUNT; c++) {
+            const ColumnChunk& column = chunks_[i].columns[c];
+            put<uint64_t>(&footer, column.offset);
+            put<uint32_t>(&footer, column.stored_size);
+            put<uint32_t>(&footer, column.raw_size);
+            put<uint8_t>(&footer, column.encoding);
+            put<double>(&footer, column.zone.min);
+            put<double>(&footer, column.zone.max);
+            put<uint8_t>(&footer, column.zone.any_nonzero);
+        }
+    }
+    put<uint64_t>(&footer, offset_);
+    footer.insert(footer.end(), FOOTER_MAGIC, FOOTER_MAGIC + sizeof(FOOTER_MAGIC));
+    if (fwrite(&footer[0], 1, footer.size(), file_) != footer.size()) {
+        ok_ = false;
+    }
+    bool ok = fflush(file_) == 0 && ok_;
+    ok = fclose(file_) == 0 && ok;
+    file_ = NULL;
+    return ok;
+}
+
+ColumnReader::ColumnReader() : data_(NULL), size_(0), chunk_frames_(0), frames_(0) {}
+
+ColumnReader::~ColumnReader() {
+    close();
+}
+
+bool ColumnReader::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(COLUMN_MAGIC) + FOOTER_TAIL_SIZE)) {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    data_ = static_cast<const char*>(data);
+    size_ = st.st_size;
+    if (memcmp(data_, COLUMN_MAGIC, sizeof(COLUMN_MAGIC)) != 0 || !read_footer()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool ColumnReader::read_footer() {
+    const char* tail = data_ + size_ - FOOTER_TAIL_SIZE;
+    if (memcmp(tail + 8, FOOTER_MAGIC, sizeof(FOOTER_MAGIC)) != 0) {
+        return false;
+    }
+    const char* p = tail;
+    uint64_t footer_offset = get<uint64_t>(&p);
+    if (footer_offset < sizeof(COLUMN_MAGIC) || footer_offset + 12 > size_ - FOOTER_TAIL_SIZE) {
+        return false;
+    }
+    p = data_ + footer_offset;
+    uint32_t columns = get<uint32_t>(&p);
+    chunk_frames_ = get<uint32_t>(&p);
+    uint32_t chunks = get<uint32_t>(&p);
+    const size_t column_size = 8 + 4 + 4 + 1 + 8 + 8 + 1;
+    if (columns != COL_COUNT || (tail - p) / (8 + COL_COUNT * column_size) < chunks) {
+        return false;
+    }
+    chunks_.resize(chunks);
+    frames_ = 0;
+    for (uint32_t i = 0; i < chunks; i++) {
+        chunks_[i].frames = get<uint32_t>(&p);
+        chunks_[i].heroes = get<uint32_t>(&p);
+        frames_ += chunks_[i].frames;
+        for (int c = 0; c < COL_COUNT; c++) {
+            ColumnChunk& column = chunks_[i].columns[c];
+            column.offset = get<uint64_t>(&p);
+            column.stored_size = get<uint32_t>(&p);
+            column.raw_size = get<uint32_t>(&p);
+            column.encoding = get<uint8_t>(&p);
+            column.zone.min = get<double>(&p);
+            column.zone.max = get<double>(&p);
+            column.zone.any_nonzero = get<uint8_t>(&p) != 0;
+            if (column.offset + column.stored_size > footer_offset) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void ColumnReader::close() {
+    if (data_) {
+        munmap(const_cast<char*>(data_), size_);
+        data_ = NULL;
+    }
+    size_ = 0;
+    frames_ = 0;
+    chunks_.clear();
+}
+
+bool ColumnReader::read_column(const size_t& chunk, const int& column, std::vector<int64_t>* values) const {
+    if (chunk >= chunks_.size() || column < 0 || column >= COL_COUNT) {
+        return false;
+    }
+    const ColumnChunk& info = chunks_[chunk].columns[column];
+    const size_t count = column >= FIRST_HERO_COLUMN ? chunks_[chunk].heroes : chunks_[chunk].frames;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data_ + info.offset);
+    if (!(info.encoding & ENC_DEFLATE)) {
+        return decode_column(p, p + info.stored_size, info.encoding, count, values);
+    }
+    std::vector<unsigned char> raw(std::max<uint32_t>(1, info.raw_size));
+    uLongf raw_size = info.raw_size;
+    if (uncompress(&raw[0], &raw_size, p, info.stored_size) != Z_OK || raw_size != info.raw_size) {
+        return false;
+    }
+    return decode_column(&raw[0], &raw[0] + raw_size, info.encoding & ~ENC_DEFLATE, count, values);
+}
+
+bool ColumnReader::read_column(const size_t& chunk, const int& column, std::vector<double>* values) const {
+    std::vector<int64_t> stored;
+    if (!read_column(chunk, column, &stored)) {
+        return false;
+    }
+    values->resize(stored.size());
+    for (size_t i = 0; i < stored.size(); i++) {
+        (*values)[i] = column_value(column, stored[i]);
+    }
+    return true;
+}
+
+bool ColumnReader::read_frames(const size_t& chunk, std::vector<FrameStatus>* frames) const {
+    std::vector<int64_t> columns[COL_COUNT];
+    for (int c = 0; c < COL_COUNT; c++) {
+        if (!read_column(chunk, c, &columns[c])) {
+            return false;
+        }
+    }
+    frames->resize(chunks_[chunk].frames);
+    size_t hero = 0;
+    for (size_t i = 0; i < frames->size(); i++) {
+        FrameStatus& status = (*frames)[i];
+        status.ts = columns[COL_TS][i];
+        status.joystick_angle = column_value(COL_JOYSTICK_ANGLE, columns[COL_JOYSTICK_ANGLE][i]);
+        status.spell1_cd = columns[COL_SPELL1_CD][i];
+        status.spell2_cd = columns[COL_SPELL2_CD][i];
+        status.spell3_cd = columns[COL_SPELL3_CD][i];
+        status.skill1_cd = columns[COL_SKILL1_CD][i];
+        status.skill2_cd = columns[COL_SKILL2_CD][i];
+        status.skill3_cd = columns[COL_SKILL3_CD][i];
+        status.skill4_cd = columns[COL_SKILL4_CD][i];
+        status.money = columns[COL_MONEY][i];
+        size_t count = columns[COL_HERO_COUNT][i];
+        if (count > chunks_[chunk].heroes - hero) {
+            return false;
+        }
+        status.hero_list.resize(count);
+        for (size_t h = 0; h < count; h++, hero++) {
+            status.hero_list[h].hero_id = columns[COL_HERO_ID][hero];
+            status.hero_list[h].position = cv::Point(columns[COL_HERO_X][hero], columns[COL_HERO_Y][hero]);
+            status.hero_list[h].level = columns[COL_HERO_LEVEL][hero];
+        }
+    }
+    return true;
+}
+
+bool parse_column_predicate(const std::string& text, ColumnPredicate* predicate) {
+    static const char* OPS[] = {"==", "!=", "<=", ">=", "<", ">", "="};
+    static const ColumnPredicate::Op OP_CODES[] = {ColumnPredicate::EQ, ColumnPredicate::NE, ColumnPredicate::LE, ColumnPredicate::GE,
+                                                   ColumnPredicate::LT, ColumnPredicate::GT, ColumnPredicate::EQ};
+    for (size_t i = 0; i < sizeof(OPS) / sizeof(OPS[0]); i++) {
+        size_t pos = text.find(OPS[i]);
+        if (pos == std::string::npos) {
+            continue;
+        }
+        predicate->column = parse_result_column(text.substr(0, pos));
+        predicate->op = OP_CODES[i];
+        std::string number = text.substr(pos + strlen(OPS[i]));
+        char* end = NULL;
+        predicate->value = strtod(number.c_str(), &end);
+        // predicates apply to per-frame columns only
+        return predicate->column < FIRST_HERO_COLUMN && !number.empty() && *end == '\0';
+    }
+    return false;
+}
+
+bool eval_predicate(const ColumnPredicate& predicate, const double& value) {
+    switch (predicate.op) {
+        case ColumnPredicate::EQ:
+            return value == predicate.value;
+        case ColumnPredicate::NE:
+            return value != predicate.value;
+        case ColumnPredicate::LT:
+            return value < predicate.value;
+        case ColumnPredicate::LE:
+            return value <= predicate.value;
+        case ColumnPredicate::GT:
+            return value > predicate.value;
+        case ColumnPredicate::GE:
+            return value >= predicate.value;
+    }
+    return false;
+}
+
+// whether some / all values of a chunk can satisfy the predicate, judging by its zone map
+bool zone_may_match(const ColumnPredicate& predicate, const ZoneMap& zone) {
+    const double v = predicate.value;
+    switch (predicate.op) {
+        case ColumnPredicate::EQ:
+            return v >= zone.min && v <= zone.max && (v == 0 || zone.any_nonzero);
+        case ColumnPredicate::NE:
+            return !(zone.min == v && zone.max == v) && (v != 0 || zone.any_nonzero);
+        case ColumnPredicate::LT:
+            return zone.min < v;
+        case ColumnPredicate::LE:
+            return zone.min <= v;
+        case ColumnPredicate::GT:
+            return zone.max > v;
+        case ColumnPredicate::GE:
+            return zone.max >= v;
+    }
+    return true;
+}
+
+static bool zone_all_match(const ColumnPredicate& predicate, const ZoneMap& zone) {
+    return eval_predicate(predicate, zone.min) && eval_predicate(predicate, zone.max) &&
+           (predicate.op != ColumnPredicate::NE || predicate.value < zone.min || predicate.value > zone.max);
+}
+
+bool select_frames(const ColumnReader& reader, const std::vector<ColumnPredicate>& predicates, std::vector<int>* ts, SelectStats* stats) {
+    ts->clear();
+    stats->chunks = reader.chunks();
+    stats->chunks_skipped = 0;
+    stats->chunks_decoded = 0;
+    stats->frames_matched = 0;
+    std::vector<double> timestamps, values;
+    std::vector<char> match;
+    for (size_t c = 0; c < reader.chunks(); c++) {
+        const ChunkInfo& chunk = reader.chunk(c);
+        bool skip = false;
+        std::vector<const ColumnPredicate*> pending;
+        for (size_t i = 0; i < predicates.size() && !skip; i++) {
+            const ZoneMap& zone = chunk.columns[predicates[i].column].zone;
+            skip = !zone_may_match(predicates[i], zone);
+            if (!zone_all_match(predicates[i], zone)) {
+                pending.push_back(&predicates[i]);
+            }
+        }
+        if (skip) {
+            stats->chunks_skipped++;
+            continue;
+        }
+        stats->chunks_decoded++;
+        if (!reader.read_column(c, COL_TS, &timestamps)) {
+            return false;
+        }
+        match.assign(chunk.frames, 1);
+        for (size_t i = 0; i < pending.size(); i++) {
+            if (!reader.read_column(c, pending[i]->column, &values)) {
+                return false;
+            }
+            for (size_t f = 0; f < values.size(); f++) {
+                match[f] = match[f] && eval_predicate(*pending[i], values[f]);
+            }
+        }
+        for (size_t f = 0; f < chunk.frames; f++) {
+            if (match[f]) {
+                ts->push_back(static_cast<int>(timestamps[f]));
+            }
+        }
+    }
+    stats->frames_matched = ts->size();
+    return true;
+}
+
+int run_select(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: game_video --select <results.gvc> <predicate>... [--print]" << std::endl;
+        return -1;
+    }
+    std::vector<ColumnPredicate> predicates;
+    bool print = false;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        ColumnPredicate predicate;
+        if (arg == "--print") {
+            print = true;
+        } else if (parse_column_predicate(arg, &predicate)) {
+            predicates.push_back(predicate);
+        } else {
+            std::cerr << "Invalid predicate " << arg << ", expected <column><op><number> on a per-frame column" << std::endl;
+            return -1;
+        }
+    }
+
+    ColumnReader reader;
+    if (!reader.open(argv[2])) {
+        std::cerr << "Cannot read column file " << argv[2] << std::endl;
+        return -1;
+    }
+    std::vector<int> ts;
+    SelectStats stats;
+    int64 start = cv::getTickCount();
+    if (!select_frames(reader, predicates, &ts, &stats)) {
+        std::cerr << "Corrupted column file " << argv[2] << std::endl;
+        return -1;
+    }
+    double ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+    if (print) {
+        for (size_t i = 0; i < ts.size(); i++) {
+            std::cout << ts[i] << std::endl;
+        }
+    }
+    std::cerr << stats.frames_matched << " of " << reader.frames() << " frames matched, " << stats.chunks_skipped << " of "
+              << stats.chunks << " chunks skipped by zone maps, " << ms << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,144 @@
+#ifndef COLUMN_STORE_H
+#define COLUMN_STORE_H
+
+#include <cstdio>
+#include <stdint.h>
+#include "game_video.h"
+
+// Chunked, compressed column store of per-frame results (.gvc), little endian.
+// Every chunk_frames frames form a chunk; each column of a chunk is encoded on its own as runs
+// (RLE) or zigzag deltas, whichever is smaller, then deflated with zlib. Hero columns hold the
+// heroes of the chunk's frames, hero_count tells how many belong to each frame.
+// Each column chunk carries a zone map (min, max, any nonzero) so selective scans decode only
+// the chunks and columns a query needs.
+// header: "GVC1", then column chunk blobs
+// footer: uint32 columns, chunk_frames, chunks, then per chunk uint32 frames, heroes and per
+//         column {uint64 offset, uint32 stored size, raw size, uint8 encoding, f64 min, max,
+//         uint8 any nonzero}; then uint64 footer offset, "GVCI"
+
+enum ResultColumn {
+    COL_TS = 0,
+    COL_JOYSTICK_ANGLE,
+    COL_SPELL1_CD,
+    COL_SPELL2_CD,
+    COL_SPELL3_CD,
+    COL_SKILL1_CD,
+    COL_SKILL2_CD,
+    COL_SKILL3_CD,
+    COL_SKILL4_CD,
+    COL_MONEY,
+    COL_HERO_COUNT,
+    COL_HERO_ID,    // hero columns, one value per hero
+    COL_HERO_X,
+    COL_HERO_Y,
+    COL_HERO_LEVEL,
+    COL_COUNT
+};
+
+// first column with one value per hero instead of per frame
+const int FIRST_HERO_COLUMN = COL_HERO_ID;
+
+const char* result_column_name(const int&);
+// COL_COUNT for an unknown name
+int parse_result_column(const std::string&);
+
+struct ZoneMap {
+    double min;
+    double max;
+    bool any_nonzero;
+};
+
+struct ColumnChunk {
+    uint64_t offset;
+    uint32_t stored_size;
+    uint32_t raw_size;
+    uint8_t encoding;
+    ZoneMap zone;
+};
+
+struct ChunkInfo {
+    uint32_t frames;
+    uint32_t heroes;
+    ColumnChunk columns[COL_COUNT];
+};
+
+class ColumnWriter {
+  private:
+    FILE* file_;
+    uint64_t offset_;
+    size_t chunk_frames_;
+    bool ok_;
+    std::vector<ChunkInfo> chunks_;
+    std::vector<int64_t> values_[COL_COUNT];    // pending chunk, joystick_angle as its bit pattern
+    std::vector<char> encoded_;
+    std::vector<unsigned char> compressed_;
+
+    void flush_chunk();
+
+  public:
+    ColumnWriter();
+    ~ColumnWriter();
+    bool open(const std::string& path, const size_t& chunk_frames = 4096);
+    bool write(const FrameStatus&);
+    // writes the pending chunk and the footer, false if any write failed
+    bool close();
+};
+
+// Memory-maps the file; decoding only reads the mapping, so one reader serves many threads.
+class ColumnReader {
+  private:
+    const char* data_;
+    size_t size_;
+    size_t chunk_frames_;
+    size_t frames_;
+    std::vector<ChunkInfo> chunks_;
+
+    bool read_footer();
+
+  public:
+    ColumnReader();
+    ~ColumnReader();
+    bool open(const std::string& path);
+    void close();
+    inline size_t chunks() const {
+        return chunks_.size();
+    }
+    inline size_t frames() const {
+        return frames_;
+    }
+    inline const ChunkInfo& chunk(const size_t& i) const {
+        return chunks_[i];
+    }
+    // decodes one column of one chunk, joystick_angle converted to its value
+    bool read_column(const size_t& chunk, const int& column, std::vector<double>* values) const;
+    bool read_column(const size_t& chunk, const int& column, std::vector<int64_t>* values) const;
+    bool read_frames(const size_t& chunk, std::vector<FrameStatus>* frames) const;
+};
+
+// Filter on a per-frame column, e.g. "skill3_cd==0" or "money>3000"
+struct ColumnPredicate {
+    enum Op { EQ = 0, NE, LT, LE, GT, GE };
+    int column;
+    Op op;
+    double value;
+};
+
+bool parse_column_predicate(const std::string&, ColumnPredicate*);
+bool eval_predicate(const ColumnPredicate&, const double& value);
+// false when no value of a column chunk with this zone map can satisfy the predicate
+bool zone_may_match(const ColumnPredicate&, const ZoneMap&);
+
+struct SelectStats {
+    size_t chunks;
+    size_t chunks_skipped;    // ruled out by zone maps
+    size_t chunks_decoded;
+    size_t frames_matched;
+};
+
+// timestamps of the frames matching all predicates
+bool select_frames(const ColumnReader&, const std::vector<ColumnPredicate>&, std::vector<int>* ts, SelectStats*);
+
+// usage: game_video --select <results.gvc> <predicate>... [--print]
+int run_select(int argc, char** argv);
+
+#endif
@@ -0,0 +1,226 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include "detection_log.h"
+
+static const char DETECTION_MAGIC[4] = {'G', 'V', 'D', '1'};
+static const size_t FLUSH_SIZE = 1 << 16;
+static const uint64_t MAX_DETECTIONS_PER_FRAME = 4096;    // guards against corrupted files
+
+static inline uint64_t zigzag(const int64_t& v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+static inline int64_t unzigzag(const uint64_t& v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+static inline void put_varint(std::vector<char>* buffer, uint64_t v) {
+    while (v >= 0x80) {
+        buffer->push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    buffer->push_back(static_cast<char>(v));
+}
+
+static inline bool get_varint(const unsigned char** p, const unsigned char* end, uint64_t* v) {
+    *v = 0;
+    for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+        unsigned char byte = *(*p)++;
+        *v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+DetectionLogWriter::DetectionLogWriter() : file_(NULL), last_ts_(0), ok_(false) {}
+
+DetectionLogWriter::~DetectionLogWriter() {
+    close();
+}
+
+bool DetectionLogWriter::open(const std::string& path) {
+    close();
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    last_ts_ = 0;
+    buffer_.assign(DETECTION_MAGIC, DETECTION_MAGIC + sizeof(DETECTION_MAGIC));
+    ok_ = true;
+    return true;
+}
+
+bool DetectionLogWriter::flush() {
+    if (!buffer_.empty() && fwrite(&buffer_[0], 1, buffer_.size(), file_) != buffer_.size()) {
+        ok_ = false;
+    }
+    buffer_.clear();
+    return ok_;
+}
+
+bool DetectionLogWriter::write(const int& ts, const std::vector<LevelDetection>& detections) {
+    if (!file_) {
+        return false;
+    }
+    put_varint(&buffer_, zigzag(static_cast<int64_t>(ts) - last_ts_));
+    put_varint(&buffer_, detections.size());
+    for (size_t i = 0; i < detections.size(); i++) {
+        const LevelDetection& detection = detections[i];
+        put_varint(&buffer_, std::max(0, detection.position.x));
+        put_varint(&buffer_, std::max(0, detection.position.y));
+        buffer_.push_back(static_cast<char>(std::min(255, std::max(0, detection.level))));
+        buffer_.push_back(static_cast<char>(std::min(255.0, std::max(0.0, std::floor(detection.error * 255 + 0.5)))));
+    }
+    last_ts_ = ts;
+    return buffer_.size() < FLUSH_SIZE || flush();
+}
+
+bool DetectionLogWriter::close() {
+    if (!file_) {
+        return true;
+    }
+    bool ok = flush();
+    ok = fflush(file_) == 0 && !ferror(file_) && ok;
+    ok = fclose(file_) == 0 && ok;
+    file_ = NULL;
+    return ok;
+}
+
+bool read_detection_log(const std::string& path, DetectionLog* log) {
+    log->frames.clear();
+    log->detections.clear();
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::vector<unsigned char> data;
+    unsigned char block[1 << 16];
+    size_t n;
+    while ((n = fread(block, 1, sizeof(block), file)) > 0) {
+        data.insert(data.end(), block, block + n);
+    }
+    bool read_ok = !ferror(file);
+    fclose(file);
+    if (!read_ok || data.size() < sizeof(DETECTION_MAGIC) || memcmp(&data[0], DETECTION_MAGIC, sizeof(DETECTION_MAGIC)) != 0) {
+        return false;
+    }
+
+    const unsigned char* p = &data[0] + sizeof(DETECTION_MAGIC);
+    const unsigned char* end = &data[0] + data.size();
+    int64_t ts = 0;
+    while (p < end) {
+        uint64_t delta, count;
+        if (!get_varint(&p, end, &delta) || !get_varint(&p, end, &count) || count > MAX_DETECTIONS_PER_FRAME) {
+            return false;
+        }
+        ts += unzigzag(delta);
+        DetectionLog::Frame frame = {static_cast<int>(ts), log->detections.size(), static_cast<size_t>(count)};
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t x, y;
+            if (!get_varint(&p, end, &x) || !get_varint(&p, end, &y) || end - p < 2) {
+                return false;
+            }
+            LevelDetection detection = {cv::Point(static_cast<int>(x), static_cast<int>(y)), p[0], p[1] / 255.0};
+            p += 2;
+            log->detections.push_back(detection);
+        }
+        log->frames.push_back(frame);
+    }
+    return true;
+}
+
+ReplayStats replay_tracker(const DetectionLog& log, const TrackerParams& params, std::vector<std::vector<HeroStatus> >* hero_lists) {
+    GameVideoAnalyzer game_video_analyzer;
+    game_video_analyzer.set_display(false);
+    game_video_analyzer.set_tracker_params(params);
+    ReplayStats stats = {log.frames.size(), log.detections.size(), 0, 0, 0, 0};
+    if (hero_lists) {
+        hero_lists->clear();
+    }
+    std::vector<LevelDetection> detections;
+    std::vector<HeroStatus> hero_status_list;
+    for (size_t f = 0; f < log.frames.size(); f++) {
+        const DetectionLog::Frame& frame = log.frames[f];
+        detections.assign(log.detections.begin() + frame.first, log.detections.begin() + frame.first + frame.count);
+        hero_status_list.clear();
+        // the order of process_frame: association, then pruning
+        game_video_analyzer.associate_heroes(detections, &hero_status_list, frame.ts);
+        game_video_analyzer.delete_inactive_heroes(frame.ts, params.inactive_ms, params.min_appearances);
+        stats.hero_statuses += hero_status_list.size();
+        if (hero_lists) {
+            hero_lists->push_back(hero_status_list);
+        }
+    }
+    stats.heroes_assigned = game_video_analyzer.heroes_assigned();
+    stats.heroes_listed = game_video_analyzer.stream().heroes_list.size();
+    stats.heroes_archived = game_video_analyzer.stream().heroes_archived;
+    return stats;
+}
+
+int run_replay_tracker(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: game_video --replay-tracker <detections.gvd> [--merge-dist 50] [--levelup-dist 10] [--retrieve 3000] "
+                  << "[--inactive 1000] [--appearances 5] [--repeat 1] [--print]" << std::endl;
+        return -1;
+    }
+    TrackerParams params = DEFAULT_TRACKER_PARAMS;
+    int repeat = 1;
+    bool print = false;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--merge-dist" && has_value) {
+            params.merge_dist = std::atof(argv[++i]);
+        } else if (arg == "--levelup-dist" && has_value) {
+            params.levelup_dist = std::atof(argv[++i]);
+        } else if (arg == "--retrieve" && has_value) {
+            params.retrieve_ms = std::atoi(argv[++i]);
+        } else if (arg == "--inactive" && has_value) {
+            params.inactive_ms = std::atoi(argv[++i]);
+        } else if (arg == "--appearances" && has_value) {
+            params.min_appearances = std::atoi(argv[++i]);
+        } else if (arg == "--repeat" && has_value) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--print") {
+            print = true;
+        } else {
+            std::cerr << "Unknown replay option " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    DetectionLog log;
+    if (!read_detection_log(argv[2], &log)) {
+        std::cerr << "Cannot read detection log " << argv[2] << std::endl;
+        return -1;
+    }
+    std::vector<std::vector<HeroStatus> > hero_lists;
+    ReplayStats stats = replay_tracker(log, params, print ? &hero_lists : NULL);
+    int64 start = cv::getTickCount();
+    for (int r = 1; r < repeat; r++) {
+        replay_tracker(log, params);
+    }
+    double ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+
+    if (print) {
+        for (size_t f = 0; f < log.frames.size(); f++) {
+            std::cout << log.frames[f].ts;
+            for (size_t h = 0; h < hero_lists[f].size(); h++) {
+                const HeroStatus& hero = hero_lists[f][h];
+                std::cout << '\t' << hero.hero_id << ':' << hero.position.x << ':' << hero.position.y << ':' << hero.level;
+            }
+            std::cout << std::endl;
+        }
+    }
+    std::cout << stats.frames << " frames, " << stats.detections << " detections, " << stats.heroes_assigned << " hero ids assigned, "
+              << stats.heroes_listed << " heroes listed at the end, " << stats.heroes_archived << " archived, " << stats.hero_statuses << " hero statuses" << std::endl;
+    if (repeat > 1) {
+        std::cout << "Replayed " << repeat - 1 << " times in " << ms << " ms, "
+                  << (repeat - 1) * stats.frames / std::max(1e-6, ms / 1000.0) << " frames/s" << std::endl;
+    }
+    return 0;
+}
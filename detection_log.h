@@ -0,0 +1,63 @@
+#ifndef DETECTION_LOG_H
+#define DETECTION_LOG_H
+
+#include <cstdio>
+#include "game_video.h"
+
+// Raw per-frame level detections (.gvd), the input of hero association, so assign_hero and
+// delete_inactive_heroes can be tuned by replaying the log instead of re-running the vision
+// pipeline. Every analyzed frame has a record, also without detections, since deletion of
+// inactive heroes depends on the timestamps alone; frames that reused the status of a duplicate
+// (see last_frame_duplicate) have none, they neither associate nor prune.
+// header: "GVD1"
+// record: zigzag varint ts difference to the previous record, varint detections,
+//         per detection varint x, varint y, uint8 level, uint8 error * 255 rounded
+
+class DetectionLogWriter {
+  private:
+    FILE* file_;
+    std::vector<char> buffer_;
+    int last_ts_;
+    bool ok_;
+
+    bool flush();
+
+  public:
+    DetectionLogWriter();
+    ~DetectionLogWriter();
+    bool open(const std::string& path);
+    bool write(const int& ts, const std::vector<LevelDetection>&);
+    // false if any write failed
+    bool close();
+};
+
+// whole log decoded into memory, replays do not touch the file
+struct DetectionLog {
+    struct Frame {
+        int ts;
+        size_t first;    // index of the first detection
+        size_t count;
+    };
+    std::vector<Frame> frames;
+    std::vector<LevelDetection> detections;
+};
+
+bool read_detection_log(const std::string& path, DetectionLog*);
+
+struct ReplayStats {
+    size_t frames;
+    size_t detections;
+    int heroes_assigned;     // hero ids handed out
+    size_t heroes_listed;    // heroes in the list after the last frame
+    size_t heroes_archived;  // heroes moved out of the list
+    size_t hero_statuses;    // sum of heroes per frame
+};
+
+// association and pruning of a fresh analyzer over the log, hero lists per frame (optional)
+ReplayStats replay_tracker(const DetectionLog&, const TrackerParams&, std::vector<std::vector<HeroStatus> >* hero_lists = NULL);
+
+// usage: game_video --replay-tracker <detections.gvd> [--merge-dist 50] [--levelup-dist 10] [--retrieve 3000]
+//        [--inactive 1000] [--appearances 5] [--repeat 1] [--print]
+int run_replay_tracker(int argc, char** argv);
+
+#endif
@@ -0,0 +1,116 @@
+#include <fstream>
+#include "frame_reader.h"
+
+FrameReader::FrameReader(const LoadFunction& load, const size_t& first, const size_t& last, const int& read_ahead)
+    : load_(load), next_(first), last_(last), read_ahead_(std::max(0, read_ahead)), stop_(false) {
+    if (read_ahead_ > 0) {
+        worker_ = std::thread(&FrameReader::run, this, first);
+    }
+}
+
+FrameReader::~FrameReader() {
+    if (worker_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        not_full_.notify_all();
+        worker_.join();
+    }
+}
+
+void FrameReader::run(const size_t first) {
+    for (size_t i = first; i < last_; i++) {
+        LoadedFrame loaded;
+        loaded.index = i;
+        if (!load_(i, &loaded.frame)) {
+            loaded.frame.release();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return stop_ || queue_.size() < read_ahead_; });
+        if (stop_) {
+            return;
+        }
+        queue_.push_back(loaded);
+        not_empty_.notify_one();
+    }
+}
+
+bool FrameReader::read(cv::Mat* frame, size_t* index) {
+    if (next_ >= last_) {
+        return false;
+    }
+    if (read_ahead_ == 0) {
+        *index = next_++;
+        if (!load_(*index, frame)) {
+            frame->release();
+        }
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return !queue_.empty(); });
+    LoadedFrame loaded = queue_.front();
+    queue_.pop_front();
+    not_full_.notify_one();
+    lock.unlock();
+
+    next_ = loaded.index + 1;
+    *index = loaded.index;
+    *frame = loaded.frame;
+    return true;
+}
+
+static int big_endian(const unsigned char* p, const int& bytes) {
+    int value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+bool read_image_size(const std::string& path, cv::Size* size) {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    unsigned char header[26];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+        return false;
+    }
+    static const unsigned char png[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    if (std::equal(png, png + 8, header)) {
+        // IHDR is the first chunk
+        *size = cv::Size(big_endian(header + 16, 4), big_endian(header + 20, 4));
+        return true;
+    }
+    if (header[0] == 'B' && header[1] == 'M') {
+        // BITMAPINFOHEADER, little endian, a negative height for top-down rows
+        const int width = header[18] | header[19] << 8 | header[20] << 16 | header[21] << 24;
+        const int height = header[22] | header[23] << 8 | header[24] << 16 | header[25] << 24;
+        *size = cv::Size(width, std::abs(height));
+        return true;
+    }
+    if (header[0] != 0xff || header[1] != 0xd8) {
+        return false;
+    }
+    // JPEG segments up to the start of frame, which holds the size
+    file.seekg(2);
+    unsigned char segment[9];
+    while (file.read(reinterpret_cast<char*>(segment), 4)) {
+        if (segment[0] != 0xff) {
+            return false;
+        }
+        const int marker = segment[1];
+        const int length = big_endian(segment + 2, 2);
+        if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc) {
+            if (!file.read(reinterpret_cast<char*>(segment + 4), 5)) {
+                return false;
+            }
+            *size = cv::Size(big_endian(segment + 7, 2), big_endian(segment + 5, 2));
+            return true;
+        }
+        if (length < 2 || !file.seekg(length - 2, std::ios::cur)) {
+            return false;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,48 @@
+#ifndef FRAME_READER_H
+#define FRAME_READER_H
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "game_video.h"
+
+// Reads frames [first, last) through a load function. With read_ahead > 0, a background
+// thread keeps up to read_ahead decoded frames ahead of the consumer, so decoding overlaps analysis.
+class FrameReader {
+  public:
+    typedef std::function<bool(const size_t& index, cv::Mat* frame)> LoadFunction;
+
+    FrameReader(const LoadFunction& load, const size_t& first, const size_t& last, const int& read_ahead);
+    ~FrameReader();
+
+    // returns false after the last frame, a frame that failed to load comes back empty
+    bool read(cv::Mat* frame, size_t* index);
+
+  private:
+    struct LoadedFrame {
+        size_t index;
+        cv::Mat frame;
+    };
+
+    LoadFunction load_;
+    size_t next_;
+    size_t last_;
+    size_t read_ahead_;
+
+    std::deque<LoadedFrame> queue_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    bool stop_;
+    std::thread worker_;
+
+    void run(const size_t first);
+};
+
+// frame size from the header of a PNG, BMP or JPEG file without decoding it (as stored, before any
+// EXIF rotation imread applies), false for other formats
+bool read_image_size(const std::string& path, cv::Size* size);
+
+#endif
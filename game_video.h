@@ -0,0 +1,356 @@
+#ifndef GAME_VIDEO_H
+#define GAME_VIDEO_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <memory>
+#include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/ml.hpp>
+#include "glyph_bank.h"
+#include "kernels.h"
+
+#define PI 3.14159265
+
+// view of a cv::Mat's pixels for the kernels, sharing its memory
+inline ImageView image_view(const cv::Mat& mat) {
+    ImageView view = {mat.data, mat.cols, mat.rows, mat.channels(), static_cast<size_t>(mat.step)};
+    return view;
+}
+
+// hero status struct
+struct HeroStatus {
+    int hero_id;
+    cv::Point position;
+    int level;
+};
+
+// lifecycle of a tracked hero: tentative until it appeared min_appearances times, confirmed while
+// seen, lost once missing longer than inactive_ms (tentative ones are deleted instead). Once missing
+// retrieve_ms assign_hero can no longer continue it, and it is moved to the archive.
+enum TrackState {
+    TRACK_TENTATIVE,
+    TRACK_CONFIRMED,
+    TRACK_LOST
+};
+
+// hero moved out of the association set; the archive keeps the most recent HERO_ARCHIVE_SIZE of them
+struct ArchivedHero {
+    int hero_id;
+    int level;    // last read level
+    cv::Point position;    // last position
+    int last_updated;
+    int appearances;
+};
+
+const size_t HERO_ARCHIVE_SIZE = 256;
+
+// all kinds of status within one frame are stored in this struct
+struct FrameStatus {
+    int ts;    // timestamp unit: ms
+    double joystick_angle;    // angle between joystick direction and horizontal, scaled [-180, 180)
+    int spell1_cd;
+    int spell2_cd;
+    int spell3_cd;
+    int skill1_cd;
+    int skill2_cd;
+    int skill3_cd;
+    int skill4_cd;
+    int money;
+    std::vector<HeroStatus> hero_list;
+};
+
+// stages of per-frame processing, used to account latency
+enum FrameStage {
+    STAGE_TRACK_HERO = 0,
+    STAGE_DELETE_INACTIVE,
+    STAGE_MONEY,
+    STAGE_COOLDOWN,
+    STAGE_JOYSTICK,
+    STAGE_COUNT
+};
+
+const char* frame_stage_name(const int& stage);
+
+// fixed HUD layout on 1280*720 frames, spell 1-3 followed by skill 1-4
+#define NUM_COOLDOWNS 7
+
+// duplicate frame detection compares luma thumbnails of this many blocks
+#define DEDUP_GRID_WIDTH 64
+#define DEDUP_GRID_HEIGHT 36
+#define DEFAULT_DEDUP_TOLERANCE 4
+extern const cv::Point COOLDOWN_CENTERS[NUM_COOLDOWNS];
+extern const cv::Rect MONEY_ROI;
+
+// hero level read off a level icon, before association with a tracked hero
+struct LevelDetection {
+    cv::Point position;
+    int level;
+    double error;    // template error, the worse digit of two-digit levels
+};
+
+// hero association, see assign_hero and delete_inactive_heroes
+struct TrackerParams {
+    double merge_dist;      // px, a detection continues a hero of the same level within this distance
+    double levelup_dist;    // px, or one of the level below within this one
+    int retrieve_ms;        // heroes missing longer are not continued, and are archived
+    int inactive_ms;        // heroes missing longer are lost, or deleted while still tentative
+    int min_appearances;    // appearances that confirm a tentative hero
+};
+
+const TrackerParams DEFAULT_TRACKER_PARAMS = {50, 10, 3000, 1000, 5};
+
+// badge of the level digits: a dark disc framed by a lighter gray ring, centered on the digits and
+// probed at a few angles; measured on the level badges of screenshot2.png, which are at frame scale
+// (their digits are as tall as samples/l*.bmp) and kept with hard negatives in samples/badges.bmp
+struct LevelBadge {
+    double radius;            // px, of the ring's middle
+    int probes;               // angles probed
+    int min_matched;          // angles whose ring is lighter than the disc that confirm a badge, some may be occluded
+    double disc_radius;       // px, where the disc is probed, between the digits and the ring
+    int disc_max;             // gray level, the disc is darker
+    int contrast;             // gray levels the ring is lighter than the disc at least
+    double digit_pitch;       // px between the digits of two-digit levels
+};
+
+const LevelBadge LEVEL_BADGE = {15, 16, 7, 11, 60, 30, 11};
+
+// anytime level search: level icon regions near the tracked heroes first, then the regions the
+// previous frame left unsearched, then the rest, until the deadline
+struct LevelSearchPlan {
+    int64 deadline;                            // cv::getTickCount() after which no region is started
+    double near_dist;                          // px, regions this close to a tracked hero go first
+    const std::vector<HeroStatus>* heroes;
+    const std::vector<cv::Rect>* resumed;      // regions deferred by the previous frame
+    std::vector<cv::Rect>* deferred;           // receives the regions left unsearched
+};
+
+// number samples and ROI mask loaded from samples folder
+struct NumberSamples {
+    std::vector<cv::Mat> cooldown;    // spell/skill cooldown font - 0-9.bmp
+    std::vector<cv::Mat> money;       // money font - m0-m9.bmp
+    std::vector<cv::Mat> level;       // hero level font - l0-l9.bmp
+    cv::Mat icon_mask;                // mask.bmp used in level icon recognizion
+};
+
+bool load_number_samples(const std::string& folder, NumberSamples* samples);
+
+// frame files are named <prefix>_<seconds>.<ext>, returns timestamp in ms
+int parse_frame_timestamp(const std::string& filename);
+
+// pipeline parameters that depend on the host, see auto_tuner.h
+struct PipelineParams {
+    int num_threads;    // OpenCV worker threads, < 0 for the whole thread budget, 0 disables threading
+    int roi_batch;      // cooldown ROIs per parallel task, NUM_COOLDOWNS runs them serially
+    int read_ahead;     // frames decoded ahead of analysis, 0 decodes synchronously
+};
+
+// without a profile OpenCV keeps its pool on every core, as before calibration existed
+const PipelineParams DEFAULT_PIPELINE_PARAMS = {-1, NUM_COOLDOWNS, 0};
+
+// fixed HUD layout and detection settings, read-only while frames are analyzed
+struct AnalyzerConfig {
+    // icon radii
+    double radius_spell;
+    double radius_skill;
+    // joystick search area and its axis
+    cv::Rect joystick_rect;
+    cv::Point joystick_axis;
+    bool display;                    // show debug windows and print per-frame logs
+    int roi_batch;                   // cooldown ROIs per parallel task
+    bool glyph_adaptation;           // learn per-video glyph variants from confident recognitions and try them first
+    TrackerParams tracker_params;
+    int dedup_tolerance;             // frames within this of the last analyzed frame reuse its status, < 0 disables
+    double level_deadline_ms;        // level search budget of track_hero per frame, <= 0 searches every region
+    bool coarse_level_discovery;     // find level icons on a half resolution mask, then read digits inside them only
+    bool level_badge_prefilter;      // read level icons only inside a LEVEL_BADGE
+};
+
+extern const AnalyzerConfig DEFAULT_ANALYZER_CONFIG;
+
+// everything one video accumulates while it is analyzed; one per stream, never shared between threads
+struct StreamState {
+    // heroes that may still be continued, with their last updated timestamp, times of appearance and
+    // lifecycle state; roughly the heroes on screen, since assign_hero scans all of them per detection
+    std::vector<HeroStatus> heroes_list;
+    std::vector<int> last_updated;
+    std::vector<int> appearances;
+    std::vector<TrackState> track_states;
+
+    // heroes that can no longer be continued, a ring of the last HERO_ARCHIVE_SIZE overwritten at
+    // hero_archive_next once full, and the count of all heroes archived
+    std::vector<ArchivedHero> hero_archive;
+    size_t hero_archive_next;
+    size_t heroes_archived;
+
+    // current unoccupied hero id
+    int hero_id;
+    bool is_heroes_list_initialized;
+
+    // distances between joystick and its axis: count, mean and sum of squared deviations
+    size_t dist_samples;
+    double dist_mean;
+    double dist_m2;
+
+    // list of status per frame, see update_frame_status
+    std::vector<FrameStatus> status_list;
+
+    // level detections of the last frame, and the blobs the level search considered for them
+    std::vector<LevelDetection> level_detections;
+    size_t level_candidates;
+    // level icon regions the deadline left unsearched in the last frame, searched early in the next
+    std::vector<cv::Rect> deferred_regions;
+
+    // glyph variants learned from this video, allocated by glyph_bank() on first use
+    std::unique_ptr<GlyphBank> glyphs;
+
+    // duplicate frame detection
+    std::vector<unsigned char> frame_thumbnail;
+    std::vector<unsigned char> analyzed_thumbnail;    // empty until a frame was analyzed
+    FrameStatus analyzed_status;
+    size_t duplicate_frames;
+    bool last_frame_duplicate;    // the last frame reused analyzed_status, the tracker and level_detections are untouched
+
+    StreamState();
+    // creates the glyph bank when glyph adaptation first asks for it, not before the frames run in parallel
+    inline GlyphBank* glyph_bank() {
+        if (!glyphs) {
+            glyphs.reset(new GlyphBank());
+        }
+        return glyphs.get();
+    }
+};
+
+// The const members are the analysis: they read the config and write only their arguments, so one
+// analyzer serves any number of threads and streams at once, each stream with its own StreamState
+// (frames of one stream stay in order). The members without a StreamState are the single-stream
+// interface on a StreamState of the analyzer's own. Setters are for setup, before frames are analyzed.
+class GameVideoAnalyzer {
+  private:
+    AnalyzerConfig config_;
+
+    // stream of the single-stream interface
+    StreamState state_;
+
+    // scores a box against a stock sample and shows the comparison
+    double compare_number_sample(cv::Mat, const cv::Mat&) const;
+    // returns the number of full resolution blobs considered, searches in the order and until the deadline of plan when not NULL;
+    // digit_boxes (optional) receives the boxes that passed the size and mask checks
+    size_t find_level_digits(const cv::Mat&, const std::vector<cv::Mat>&, const cv::Mat& mask, const double&, const size_t&, GlyphBank*, const LevelSearchPlan*, std::vector<std::pair<cv::Point, int> >*, std::vector<double>*,
+                             std::vector<cv::Rect>* digit_boxes = NULL) const;
+
+  public:
+    GameVideoAnalyzer();
+    explicit GameVideoAnalyzer(const AnalyzerConfig&);
+    void adjust_size(cv::Mat*) const;
+    // glyph_bank is consulted and taught when not NULL, error (optional) receives the template error of the detected number
+    int detect_number_roi(cv::Mat*, const cv::Rect&, const std::vector<cv::Mat>&, const double&, GlyphBank* glyph_bank, double* error = NULL) const;
+    int detect_number_fixed(cv::Mat*, const std::vector<cv::Mat>&, const double&, const size_t&, const cv::Vec4d&, GlyphBank* glyph_bank) const;
+    // dist (optional) receives the distance between joystick and axis when the joystick was found
+    double estimate_joystick_angle(cv::Mat*, double* dist = NULL) const;
+    void estimate_js_axis_status(const StreamState&, double*, double*) const;
+    // track_hero is detect_levels, then associate_heroes of the detections; with a level deadline it is
+    // anytime, regions left at the deadline are kept in the stream's deferred_regions for the next frame
+    void track_hero(cv::Mat*, StreamState*, std::vector<HeroStatus>*, const int& ts, const std::vector<cv::Mat>&, const cv::Mat&, const double&, const size_t&) const;
+    // candidates (optional) receives the number of blobs considered, plan (optional) bounds the search;
+    // display searches the same way and draws the digit boxes considered
+    void detect_levels(cv::Mat*, const std::vector<cv::Mat>&, const cv::Mat&, const double&, const size_t&, GlyphBank*, std::vector<LevelDetection>*, size_t* candidates = NULL,
+                       const LevelSearchPlan* plan = NULL) const;
+    void associate_heroes(const std::vector<LevelDetection>&, StreamState*, std::vector<HeroStatus>*, const int& ts) const;
+    bool is_black_white(const cv::Mat&) const;
+    void assign_hero(const int&, const cv::Point&, StreamState*, std::vector<HeroStatus>*, const int&) const;
+    void delete_inactive_heroes(StreamState*, const int&, const int&, const int&) const;
+    // run all detections on one resized frame of the stream, stage_ms (optional) receives STAGE_COUNT latencies
+    void process_frame(cv::Mat*, const int& ts, const NumberSamples&, StreamState*, FrameStatus*, double* stage_ms = NULL) const;
+
+    // single-stream interface
+    inline void process_frame(cv::Mat* src, const int& ts, const NumberSamples& samples, FrameStatus* status, double* stage_ms = NULL) {
+        process_frame(src, ts, samples, &state_, status, stage_ms);
+    }
+    inline void associate_heroes(const std::vector<LevelDetection>& detections, std::vector<HeroStatus>* hero_status_list, const int& ts) {
+        associate_heroes(detections, &state_, hero_status_list, ts);
+    }
+    inline void delete_inactive_heroes(const int& ts, const int& inactive_time, const int& num_app) {
+        delete_inactive_heroes(&state_, ts, inactive_time, num_app);
+    }
+    inline void estimate_js_axis_status(double* mean, double* stdvar) const {
+        estimate_js_axis_status(state_, mean, stdvar);
+    }
+    inline void update_frame_status(const FrameStatus& frame_status) {
+        state_.status_list.push_back(frame_status);
+    }
+    inline StreamState& stream() {
+        return state_;
+    }
+    inline const StreamState& stream() const {
+        return state_;
+    }
+    inline int heroes_assigned() const {
+        return state_.hero_id;
+    }
+    inline const std::vector<LevelDetection>& level_detections() const {
+        return state_.level_detections;
+    }
+    // frames that reused the status of a duplicate
+    inline size_t duplicate_frames() const {
+        return state_.duplicate_frames;
+    }
+    inline bool last_frame_duplicate() const {
+        return state_.last_frame_duplicate;
+    }
+    inline GlyphBankStats glyph_bank_stats() const {
+        return state_.glyphs ? state_.glyphs->stats() : GlyphBankStats();
+    }
+    inline size_t joystick_samples() const {
+        return state_.dist_samples;
+    }
+
+    inline const AnalyzerConfig& config() const {
+        return config_;
+    }
+    inline void set_display(const bool& display) {
+        config_.display = display;
+    }
+    inline void set_roi_batch(const int& roi_batch) {
+        config_.roi_batch = std::max(1, roi_batch);
+    }
+    inline void set_tracker_params(const TrackerParams& tracker_params) {
+        config_.tracker_params = tracker_params;
+    }
+    inline const TrackerParams& tracker_params() const {
+        return config_.tracker_params;
+    }
+    inline void set_dedup_tolerance(const int& dedup_tolerance) {
+        config_.dedup_tolerance = dedup_tolerance;
+    }
+    inline void set_glyph_adaptation(const bool& glyph_adaptation) {
+        config_.glyph_adaptation = glyph_adaptation;
+    }
+    inline void set_level_deadline(const double& level_deadline_ms) {
+        config_.level_deadline_ms = level_deadline_ms;
+    }
+    inline void set_coarse_level_discovery(const bool& coarse_level_discovery) {
+        config_.coarse_level_discovery = coarse_level_discovery;
+    }
+    inline void set_level_badge_prefilter(const bool& level_badge_prefilter) {
+        config_.level_badge_prefilter = level_badge_prefilter;
+    }
+    inline double cooldown_radius(const int& i) const {
+        return i < 3 ? config_.radius_spell : config_.radius_skill;
+    }
+};
+
+// whether a LEVEL_BADGE frames the level digits in icon, which may be one digit of two
+bool has_level_badge(const ImageView& frame, const cv::Rect& icon);
+
+// sizes the thread pool for in-frame parallelism (see thread_policy.h) and sets ROI batching,
+// read_ahead is applied by FrameReader
+void apply_pipeline_params(const PipelineParams&, GameVideoAnalyzer*);
+
+#endif
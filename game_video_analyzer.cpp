@@ -0,0 +1,1047 @@
+#include "game_video.h"
+#include "thread_policy.h"
+
+const cv::Point COOLDOWN_CENTERS[NUM_COOLDOWNS] = {
+    cv::Point(1161, 420), cv::Point(1028, 497), cv::Point(949, 630),
+    cv::Point(643, 644), cv::Point(738, 644), cv::Point(837, 644), cv::Point(1155, 279)
+};
+const cv::Rect MONEY_ROI(18, 340, 64, 22);
+
+// joystick locations are hardcoded
+// cv::Point joystick_axis(201, 568);    // var = 8.2252
+// cv::Point joystick_axis(206, 559);    // var = 7.7941
+// cv::Point joystick_axis(196, 569);    // var = 9.3208
+const AnalyzerConfig DEFAULT_ANALYZER_CONFIG = {
+    52.0, 40.0, cv::Rect(58, 411, 294, 309), cv::Point(206, 559), true, NUM_COOLDOWNS, false, DEFAULT_TRACKER_PARAMS, -1, 0, false, false
+};
+
+StreamState::StreamState() : hero_archive_next(0), heroes_archived(0), hero_id(0), is_heroes_list_initialized(false), dist_samples(0), dist_mean(0), dist_m2(0), level_candidates(0), duplicate_frames(0), last_frame_duplicate(false) {}
+
+GameVideoAnalyzer::GameVideoAnalyzer() : config_(DEFAULT_ANALYZER_CONFIG) {}
+
+GameVideoAnalyzer::GameVideoAnalyzer(const AnalyzerConfig& config) : config_(config) {
+    config_.roi_batch = std::max(1, config_.roi_batch);
+}
+
+void GameVideoAnalyzer::adjust_size(cv::Mat* frame) const {
+    // always resize frame image to 1280*720
+    if (frame->cols != 1280 || frame->rows != 720) {
+        cv::resize(*frame, *frame, cv::Size(1280, 720), 0, 0, cv::INTER_LINEAR);
+    }
+}
+
+int GameVideoAnalyzer::detect_number_roi(cv::Mat* src, const cv::Rect& box, const std::vector<cv::Mat>& number_samples, const double& avg_err_thres, GlyphBank* glyph_bank, double* error) const {
+    double min_avg_err = avg_err_thres;   // averge error threshold
+    int number_detected = -1;
+
+    // learned variants of this video's glyphs first, the font is told apart by its sample pixels
+    const void* font = number_samples[0].data;
+    if (glyph_bank) {
+        int variant_detected = glyph_bank->match(font, image_view(*src), box.x, box.y, box.width, box.height, error);
+        if (variant_detected != -1) {
+            return variant_detected;
+        }
+    }
+    // best and second best errors over all samples, the margin tells how confident a recognition is
+    double best_err = 1.0, next_err = 1.0;
+
+    for (size_t i = 0; i < 10; i++) {
+        // std::cout << i << ',';
+        cv::Mat src_roi = (*src)(box);
+        cv::Mat number_sample = number_samples[i];
+
+        // check h/w ratio
+        double hw_ratio_roi = static_cast<double>(src_roi.rows) / static_cast<double>(src_roi.cols);
+        double hw_ratio_sample = static_cast<double>(number_sample.rows) / static_cast<double>(number_sample.cols);
+        if (hw_ratio_roi / hw_ratio_sample > 1.3 || hw_ratio_roi / hw_ratio_sample < 0.8) {
+            continue;
+        }
+
+        double avg_err = 0;
+        if (!config_.display) {
+            // scores the box against the sample in place, without a resized copy
+            avg_err = template_error(image_view(*src), box.x, box.y, box.width, box.height, image_view(number_sample));
+        } else {
+            avg_err = compare_number_sample(src_roi, number_sample);
+        }
+        if (avg_err < min_avg_err) {
+            min_avg_err = avg_err;
+            number_detected = i;
+        }
+        next_err = std::min(next_err, std::max(best_err, avg_err));
+        best_err = std::min(best_err, avg_err);
+    }
+    if (glyph_bank && number_detected != -1) {
+        const cv::Mat& number_sample = number_samples[number_detected];
+        glyph_bank->learn(font, number_detected, min_avg_err, next_err, image_view(*src), box.x, box.y, box.width, box.height,
+                          number_sample.cols, number_sample.rows);
+    }
+    if (error) {
+        *error = min_avg_err;
+    }
+    return number_detected;
+}
+
+double GameVideoAnalyzer::compare_number_sample(cv::Mat src_roi, const cv::Mat& number_sample) const {
+    double avg_err = 0;
+    cv::resize(src_roi, src_roi, cv::Size(number_sample.cols, number_sample.rows), 0, 0, cv::INTER_NEAREST);
+
+    // for visualization
+    cv::Mat number_compare(src_roi.rows, src_roi.cols * 3, CV_8UC3, cv::Scalar(0, 0, 0));
+    cv::Mat number_diff = number_compare(cv::Rect(src_roi.cols * 2, 0, src_roi.cols, src_roi.rows));
+    cv::cvtColor(src_roi, number_compare(cv::Rect(0, 0, src_roi.cols, src_roi.rows)), cv::COLOR_GRAY2BGR);
+    cv::cvtColor(number_sample, number_compare(cv::Rect(src_roi.cols, 0, src_roi.cols, src_roi.rows)), cv::COLOR_GRAY2BGR);
+
+    for (size_t iy = 0; iy < src_roi.rows; iy++) {
+        for (size_t ix = 0; ix < src_roi.cols; ix++) {
+            if (src_roi.at<uchar>(iy, ix) == 0xff && number_sample.at<uchar>(iy, ix) == 0) {
+                number_diff.at<cv::Vec3b>(iy, ix) = cv::Vec3b(0, 0, 255);
+                avg_err += 1.0f;
+            } else if (src_roi.at<uchar>(iy, ix) == 0 && number_sample.at<uchar>(iy, ix) == 0xff) {
+                number_diff.at<cv::Vec3b>(iy, ix) = cv::Vec3b(0, 255, 0);
+                avg_err += 1.0f;
+            } else if (src_roi.at<uchar>(iy, ix) == number_sample.at<uchar>(iy, ix)) {
+                number_diff.at<cv::Vec3b>(iy, ix) = cv::Vec3b(255, 0, 0);
+            }
+        }
+    }
+    avg_err /= static_cast<double>(src_roi.cols * src_roi.rows);
+    // std::cout << avg_err << std::endl;
+
+    cv::namedWindow("cur, sam, dif");
+    cv::imshow("cur, sam, dif", number_compare);
+    // cv::waitKey(0);
+    return avg_err;
+}
+
+static bool left_of(const std::pair<int, int>& a, const std::pair<int, int>& b) {
+    return a.first < b.first;
+}
+
+int GameVideoAnalyzer::detect_number_fixed(cv::Mat* src, const std::vector<cv::Mat>& number_samples, const double& avg_err_thres, const size_t& bw_thres, const cv::Vec4d& size_restrict, GlyphBank* glyph_bank) const {
+    // pass cropped number image into this function; cooldown ROIs run in parallel, so scratch is per thread
+    static thread_local std::vector<cv::Rect> number_boxes;
+    static thread_local std::vector<std::pair<int, int> > coord_num_vec;    // x coordinate and number detected
+    number_boxes.clear();
+    coord_num_vec.clear();
+    if (!config_.display) {
+        // threshold and blobs straight from the BGR crop
+        static thread_local ImageBuffer bw_buffer;
+        static thread_local BlobScratch blob_scratch;
+        static thread_local std::vector<Blob> blobs;
+        ImageView& bw = bw_buffer.create(src->cols, src->rows, 1);
+        gray_threshold(image_view(*src), bw_thres, &bw);
+        find_blobs(bw, &blobs, &blob_scratch);
+        for (size_t i = 0; i < blobs.size(); i++) {
+            number_boxes.push_back(cv::Rect(blobs[i].x, blobs[i].y, blobs[i].width, blobs[i].height));
+        }
+        *src = cv::Mat(bw.height, bw.width, CV_8UC1, bw.data, bw.stride);
+    } else {
+        cv::cvtColor(*src, *src, cv::COLOR_BGR2GRAY);
+        cv::threshold(*src, *src, bw_thres, 255, cv::THRESH_BINARY);
+
+        cv::namedWindow("src_bw");
+        cv::imshow("src_bw", *src);
+
+        std::vector<std::vector<cv::Point>> contours;
+        cv::findContours(*src, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_NONE);
+        for (size_t i = 0; i < contours.size(); i++) {
+            number_boxes.push_back(cv::boundingRect(contours[i]));
+        }
+    }
+
+    for (size_t i = 0; i < number_boxes.size(); i++) {
+        const cv::Rect& number_box = number_boxes[i];
+        // std::cout << number_box << std::endl;
+
+        // size of segmented regions are restricted
+        // according to a ratio to the size if input is all 0
+        if (size_restrict == cv::Vec4d(0, 0, 0, 0)) {
+            if (static_cast<double>(number_box.height) > static_cast<double>(src->rows) / 1.3 ||
+                static_cast<double>(number_box.height) < static_cast<double>(src->rows) / 1.6) {
+                continue;
+            }
+            if (static_cast<double>(number_box.width) > static_cast<double>(src->cols) / 4.1 ||
+                static_cast<double>(number_box.width) < static_cast<double>(src->cols) / 9.3) {
+                continue;
+            }
+        } else {
+            // or according to input restrictions
+            // size_restrict = cv::Vec4b(height_min, height_max, width_min, width_max)
+            if (number_box.height > size_restrict[1] || number_box.height < size_restrict[0]) {
+                continue;
+            }
+            if (number_box.width > size_restrict[3] || number_box.width < size_restrict[2]) {
+                continue;
+            }
+        }
+
+        int number_detected = detect_number_roi(src, number_box, number_samples, avg_err_thres, glyph_bank);
+        if (number_detected != -1) {
+            coord_num_vec.push_back(std::pair<int, int>(number_box.x, number_detected));
+        }
+    }
+
+    // digits left to right, the first one detected at an x coordinate wins like a map insert
+    std::stable_sort(coord_num_vec.begin(), coord_num_vec.end(), left_of);
+    int cooldown = 0;
+    for (size_t i = 0; i < coord_num_vec.size(); i++) {
+        if (i > 0 && coord_num_vec[i].first == coord_num_vec[i - 1].first) {
+            continue;
+        }
+        cooldown *= 10;
+        cooldown += coord_num_vec[i].second;
+    }
+    return cooldown;
+}
+
+double GameVideoAnalyzer::estimate_joystick_angle(cv::Mat* src, double* dist) const {
+    const cv::Point joystick_lu = config_.joystick_rect.tl();
+    const cv::Point& joystick_axis = config_.joystick_axis;
+    cv::Mat joystick_rect = (*src)(config_.joystick_rect);
+    // HoughCircles still allocates its own buffers, its input and output are reused
+    static thread_local cv::Mat joystick_gray;
+    static thread_local std::vector<cv::Vec3f> circles;
+    cv::cvtColor(joystick_rect, joystick_gray, cv::COLOR_BGR2GRAY);
+    cv::HoughCircles(joystick_gray, circles, cv::HOUGH_GRADIENT, 1, 100, 50, 20, 40, 50);
+    if (config_.display) {
+        cv::line(*src, (joystick_axis - cv::Point(10, 0)), (joystick_axis + cv::Point(30, 0)), cv::Scalar(0, 0, 255), 3);
+        cv::line(*src, (joystick_axis - cv::Point(0, 10)), (joystick_axis + cv::Point(0, 10)), cv::Scalar(0, 0, 255), 3);
+    }
+    double joystick_angle = 666.0;
+    if (!circles.empty()) {
+        cv::Point circle_center = joystick_lu + cv::Point(circles[0][0], circles[0][1]);
+        if (config_.display) {
+            cv::circle(*src, circle_center, circles[0][2], cv::Scalar(0, 0, 255), 3);
+            cv::line(*src, joystick_axis, circle_center, cv::Scalar(0, 0, 255), 3);
+        }
+        if (dist) {
+            *dist = sqrt(pow(circle_center.x - joystick_axis.x, 2) + pow(circle_center.y - joystick_axis.y, 2));
+        }
+        joystick_angle = atan2(joystick_axis.y - circle_center.y, circle_center.x - joystick_axis.x) * 180 / PI;
+    }
+    return joystick_angle;
+}
+
+void GameVideoAnalyzer::estimate_js_axis_status(const StreamState& stream, double* mean, double* stdvar) const {
+    // std var is used to validate joystick axis coordinates
+    if (stream.dist_samples == 0) {
+        return;
+    }
+    *mean = stream.dist_mean;
+    *stdvar = sqrt(stream.dist_m2 / (stream.dist_samples - 1));
+}
+
+bool GameVideoAnalyzer::is_black_white(const cv::Mat& src) const {
+    if (!config_.display) {
+        // same HSV test without the converted and split copies
+        return count_saturated(image_view(src), 70, 30) < std::max(12, src.cols * 2);
+    }
+    int color_pixels = 0;
+    cv::Mat src_hsv;
+    std::vector<cv::Mat> src_hsv_vec;
+    cv::cvtColor(src, src_hsv, cv::COLOR_BGR2HSV);
+    cv::split(src_hsv, src_hsv_vec);
+    for (size_t iy = 0; iy < src.rows; iy++) {
+        for (size_t ix = 0; ix < src.cols; ix++) {
+            // check Saturation and Value in HSV space
+            if (src_hsv_vec[1].at<uchar>(iy, ix) > 70 && src_hsv_vec[2].at<uchar>(iy, ix) > 30) {
+                // std::cout << "color pixel with rgb = " << src.at<cv::Vec3b>(iy, ix) << " and hsv = " << src_hsv.at<cv::Vec3b>(iy, ix) << std::endl;
+                color_pixels++;
+            }
+        }
+    }
+    bool bw = color_pixels < std::max(12, src.cols * 2);
+    if (config_.display) {
+        std::cout << "Color pixels " << color_pixels;
+        std::cout << (bw ? " ROI bw check succeed!" : " ROI bw check failed!") << std::endl;
+    }
+    return bw;
+}
+
+// appends a new tentative hero to the association set
+static void add_hero(StreamState* stream, const HeroStatus& hero, const int& ts) {
+    stream->heroes_list.push_back(hero);
+    stream->last_updated.push_back(ts);
+    stream->appearances.push_back(1);
+    stream->track_states.push_back(TRACK_TENTATIVE);
+}
+
+// continues hero i at a new position and level, confirming it once it appeared often enough
+static void continue_hero(StreamState* stream, const size_t& i, const cv::Point& position, const int& level, const int& ts, const int& min_appearances) {
+    stream->heroes_list[i].position = position;
+    stream->heroes_list[i].level = level;
+    stream->last_updated[i] = ts;
+    stream->appearances[i]++;
+    if (stream->track_states[i] == TRACK_LOST || stream->appearances[i] >= min_appearances) {
+        stream->track_states[i] = TRACK_CONFIRMED;
+    }
+}
+
+static bool same_distance(const std::pair<double, int>& a, const std::pair<double, int>& b) {
+    return a.first == b.first;
+}
+
+void GameVideoAnalyzer::assign_hero(const int& level, const cv::Point& position, StreamState* stream, std::vector<HeroStatus>* hero_status_list, const int& ts) const {
+    const TrackerParams& tracker_params = config_.tracker_params;
+    const std::vector<HeroStatus>& heroes_list = stream->heroes_list;
+    const std::vector<int>& last_updated = stream->last_updated;
+    if (stream->is_heroes_list_initialized == false) {
+        if (config_.display) {
+            std::cout << "Initializing heroes list..." << std::endl;
+        }
+        HeroStatus hero = {stream->hero_id++, position, level};
+        hero_status_list->push_back(hero);
+        add_hero(stream, hero, ts);
+    } else {
+        // search all heroes whose distance is below threshold,
+        // pick the nearest one with the same level,
+        // if there's no same level, pick the nearest one with 1 level lower, given a smaller distance threshold is fulfilled.
+        double dist_min = tracker_params.merge_dist;   // min dist threshold
+        // distance and index, nearest first; a hero at the same distance as a nearer index is skipped
+        static thread_local std::vector<std::pair<double, int> > heroes_nearby;
+        heroes_nearby.clear();
+        for (size_t i = 0; i < heroes_list.size(); i++) {
+            double dist = sqrt(pow(position.x - heroes_list[i].position.x, 2) + 
+                               pow(position.y - heroes_list[i].position.y, 2));
+            if (dist < dist_min) {
+                heroes_nearby.push_back(std::pair<double, int>(dist, i));
+            }
+        }
+        std::sort(heroes_nearby.begin(), heroes_nearby.end());
+        heroes_nearby.erase(std::unique(heroes_nearby.begin(), heroes_nearby.end(), same_distance), heroes_nearby.end());
+        if (config_.display) {
+            std::cout << "Identified level " << level << " hero at " << position << ", ";
+        }
+        if (heroes_nearby.empty()) {
+            // new hero
+            HeroStatus hero = {stream->hero_id++, position, level};
+            hero_status_list->push_back(hero);
+            add_hero(stream, hero, ts);
+            if (config_.display) {
+                std::cout << "assign new hero id (map empty) = " << hero.hero_id << std::endl;
+            }
+        } else {
+            bool new_hero_flag = true;
+            for (auto it = heroes_nearby.begin(); it != heroes_nearby.end(); it++) {
+                if (heroes_list[it->second].level == level) {
+                    // TODO: should this time threshold here be the same as the one to detect inactive heroes?
+                    if (ts - last_updated[it->second] < tracker_params.retrieve_ms) {
+                        // don't retrieve hero after it's been missing for at least 3000ms
+                        HeroStatus hero = {heroes_list[it->second].hero_id, position, level};
+                        hero_status_list->push_back(hero);
+                        continue_hero(stream, it->second, position, level, ts, tracker_params.min_appearances);
+                        new_hero_flag = false;
+                        if (config_.display) {
+                            std::cout << "merge old hero id = " << hero.hero_id << std::endl;
+                        }
+                        break;
+                    }
+                }
+            }
+            if (new_hero_flag) {
+                for (auto it = heroes_nearby.begin(); it != heroes_nearby.end(); it++) {
+                    if (heroes_list[it->second].level == level - 1 && it->first < tracker_params.levelup_dist) {
+                        // smaller threshold @ 10 pixels
+                        if (ts - last_updated[it->second] < tracker_params.retrieve_ms) {
+                            // don't retrieve hero after it's been missing for at least 3000ms
+                            HeroStatus hero = {heroes_list[it->second].hero_id, position, level};
+                            hero_status_list->push_back(hero);
+                            continue_hero(stream, it->second, position, level, ts, tracker_params.min_appearances);
+                            new_hero_flag = false;
+                            if (config_.display) {
+                                std::cout << "merge old hero id (levelup) = " << hero.hero_id << std::endl;
+                            }
+                            break;
+                        }
+                    }
+                }
+            }
+            if (new_hero_flag) {
+                // new hero
+                HeroStatus hero = {stream->hero_id++, position, level};
+                hero_status_list->push_back(hero);
+                add_hero(stream, hero, ts);
+                if (config_.display) {
+                    std::cout << "assign new hero id (default) = " << hero.hero_id << std::endl;
+                }
+            }
+
+        }
+    }
+}
+
+// rows of a level search stripe: 1280 BGR pixels by 48 rows (180 KB) and their binary rows stay in L2
+static const int LEVEL_STRIPE_ROWS = 48;
+
+// binarizes and labels stripes of the frame for the level search, each into its own scratch
+class LevelStripeBody : public cv::ParallelLoopBody {
+  private:
+    ImageView bgr_;
+    ImageView binary_;
+    int thres_;
+    std::vector<BlobScratch>* stripes_;
+
+  public:
+    LevelStripeBody(const ImageView& bgr, const ImageView& binary, const int& thres, std::vector<BlobScratch>* stripes)
+        : bgr_(bgr), binary_(binary), thres_(thres), stripes_(stripes) {}
+
+    void operator()(const cv::Range& range) const {
+        for (int s = range.start; s < range.end; s++) {
+            const int first_row = s * LEVEL_STRIPE_ROWS;
+            const int end_row = std::min(bgr_.height, first_row + LEVEL_STRIPE_ROWS);
+            ImageView binary = binary_.roi(0, first_row, binary_.width, end_row - first_row);
+            gray_threshold(bgr_.roi(0, first_row, bgr_.width, end_row - first_row), thres_, &binary);
+            label_runs(binary_, first_row, end_row, &(*stripes_)[s]);
+        }
+    }
+};
+
+// coarse level discovery: icons are found on a mask this many times smaller
+static const int LEVEL_DISCOVERY_SCALE = 2;
+
+// a level icon: one digit box, or two side by side; boxes and regions are reordered by priority
+struct LevelRegion {
+    int priority;    // 0 near a tracked hero, 1 deferred by the previous frame, 2 the rest
+    size_t first;    // first box
+    size_t count;
+    cv::Rect rect;
+};
+
+static bool higher_priority(const LevelRegion& a, const LevelRegion& b) {
+    return a.priority < b.priority;
+}
+
+static bool box_above(const cv::Rect& a, const cv::Rect& b) {
+    return a.y < b.y || (a.y == b.y && a.x < b.x);
+}
+
+// groups digit boxes into level icons like the pairing of detect_levels, then orders them as planned
+// (plan may be NULL, the icons stay in raster order)
+static void order_level_regions(const LevelSearchPlan* plan, std::vector<cv::Rect>* boxes, std::vector<cv::Rect>* ordered, std::vector<LevelRegion>* regions) {
+    std::sort(boxes->begin(), boxes->end(), box_above);
+    static thread_local std::vector<bool> grouped;
+    grouped.assign(boxes->size(), false);
+    ordered->clear();
+    regions->clear();
+    for (size_t i = 0; i < boxes->size(); i++) {
+        if (grouped[i]) {
+            continue;
+        }
+        const cv::Rect& box = (*boxes)[i];
+        LevelRegion region = {2, ordered->size(), 1, box};
+        ordered->push_back(box);
+        for (size_t j = i + 1; j < boxes->size() && (*boxes)[j].y - box.y < 3; j++) {
+            if (!grouped[j] && abs((*boxes)[j].x - box.x) < 15 && abs((*boxes)[j].x - box.x) > 8) {
+                grouped[j] = true;
+                ordered->push_back((*boxes)[j]);
+                region.rect |= (*boxes)[j];
+                region.count++;
+                break;
+            }
+        }
+        if (plan) {
+            const int near = static_cast<int>(plan->near_dist);
+            const cv::Rect near_rect(region.rect.x - near, region.rect.y - near, region.rect.width + 2 * near, region.rect.height + 2 * near);
+            for (size_t h = 0; h < plan->heroes->size() && region.priority > 0; h++) {
+                if (near_rect.contains((*plan->heroes)[h].position)) {
+                    region.priority = 0;
+                }
+            }
+            for (size_t r = 0; r < plan->resumed->size() && region.priority > 1; r++) {
+                // heroes move a few pixels between frames
+                const cv::Rect& resumed = (*plan->resumed)[r];
+                if ((region.rect & cv::Rect(resumed.x - 4, resumed.y - 4, resumed.width + 8, resumed.height + 8)).area() > 0) {
+                    region.priority = 1;
+                }
+            }
+        }
+        regions->push_back(region);
+    }
+    std::stable_sort(regions->begin(), regions->end(), higher_priority);
+}
+
+// pixel offsets of the LEVEL_BADGE probes: the disc, and the ring at its radius and one pixel inside
+// and outside, so a center estimated a pixel or two off still finds the ring
+struct BadgeTemplate {
+    std::vector<cv::Point> disc;
+    std::vector<cv::Point> offsets[3];
+
+    static cv::Point offset(const double& radius, const double& angle) {
+        return cv::Point(static_cast<int>(std::floor(radius * std::cos(angle) + 0.5)), static_cast<int>(std::floor(radius * std::sin(angle) + 0.5)));
+    }
+
+    BadgeTemplate() {
+        const LevelBadge& badge = LEVEL_BADGE;
+        for (int i = 0; i < badge.probes; i++) {
+            const double angle = 2 * PI * i / badge.probes;
+            disc.push_back(offset(badge.disc_radius, angle));
+            for (int r = 0; r < 3; r++) {
+                offsets[r].push_back(offset(badge.radius + r - 1, angle));
+            }
+        }
+    }
+};
+
+// the ring is told by its contrast to the disc rather than by its color, since it is a light gray
+// like much of the terrain; probes are matched along the ray of each angle
+bool has_level_badge(const ImageView& frame, const cv::Rect& icon) {
+    static const BadgeTemplate badge_template;
+    const LevelBadge& badge = LEVEL_BADGE;
+    const int cx = icon.x + icon.width / 2, cy = icon.y + icon.height / 2;
+    const int half_pitch = static_cast<int>(badge.digit_pitch / 2);
+    const int shifts[5] = {0, -half_pitch + 2, half_pitch - 2, -half_pitch - 1, half_pitch + 1};
+    for (int s = 0; s < 5; s++) {
+        int matched = 0;
+        for (int i = 0; i < badge.probes && matched + badge.probes - i >= badge.min_matched; i++) {
+            const int disc = gray_at(frame, cx + shifts[s] + badge_template.disc[i].x, cy + badge_template.disc[i].y);
+            if (disc < 0 || disc > badge.disc_max) {
+                continue;
+            }
+            for (int r = 0; r < 3; r++) {
+                const cv::Point& offset = badge_template.offsets[r][i];
+                if (gray_at(frame, cx + shifts[s] + offset.x, cy + offset.y) >= disc + badge.contrast) {
+                    matched++;
+                    break;
+                }
+            }
+        }
+        if (matched >= badge.min_matched) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t GameVideoAnalyzer::find_level_digits(const cv::Mat& src, const std::vector<cv::Mat>& number_samples, const cv::Mat& mask, const double& avg_err_thres, const size_t& bw_thres, GlyphBank* glyph_bank, const LevelSearchPlan* plan, std::vector<std::pair<cv::Point, int> >* rect_num_vec, std::vector<double>* rect_err_vec, std::vector<cv::Rect>* digit_boxes) const {
+    // search buffers and the filled mask are reused across frames, per thread since streams run in parallel
+    static thread_local ImageBuffer level_bw;
+    static thread_local BlobScratch blob_scratch;
+    static thread_local std::vector<Blob> level_blobs;
+    static thread_local std::vector<BlobScratch> level_stripes;
+    static thread_local ImageBuffer level_coarse;
+    static thread_local std::vector<Blob> window_blobs;
+    static thread_local BlobScratch window_scratch;
+    static thread_local std::vector<cv::Rect> level_boxes;
+    static thread_local std::vector<cv::Rect> ordered_boxes;
+    static thread_local std::vector<LevelRegion> level_regions;
+    static thread_local cv::Mat filled_mask;
+    static thread_local const uchar* filled_mask_source = NULL;
+    if (filled_mask_source != mask.data || filled_mask.size() != mask.size()) {
+        // pointPolygonTest(...) > 0 against every mask contour, as a lookup raster:
+        // contour interiors filled, the contours themselves left out
+        std::vector<std::vector<cv::Point>> contours_mask;
+        cv::findContours(mask, contours_mask, cv::RETR_LIST, cv::CHAIN_APPROX_NONE);
+        filled_mask = cv::Mat::zeros(mask.size(), CV_8UC1);
+        cv::drawContours(filled_mask, contours_mask, -1, cv::Scalar(255), cv::FILLED);
+        cv::drawContours(filled_mask, contours_mask, -1, cv::Scalar(0), 1);
+        filled_mask_source = mask.data;
+    }
+
+    // digit boxes by the cheap checks of size and mask
+    auto add_digit_box = [](const Blob& blob, const int& dx, const int& dy) {
+        // size of segmented regions are restricted
+        if (blob.height > 15 || blob.height < 12 || blob.width > 10 || blob.width < 4) {
+            return;
+        }
+        cv::Rect number_box(blob.x + dx, blob.y + dy, blob.width, blob.height);
+        const int xs[2] = {number_box.x, number_box.x + number_box.width};
+        const int ys[2] = {number_box.y, number_box.y + number_box.height};
+        bool masked = false;
+        for (int c = 0; c < 4 && !masked; c++) {
+            const int x = xs[c & 1], y = ys[c >> 1];
+            masked = x < filled_mask.cols && y < filled_mask.rows && filled_mask.at<uchar>(y, x) != 0;
+        }
+        if (!masked) {
+            level_boxes.push_back(number_box);
+        }
+    };
+
+    const ImageView frame = image_view(src);
+    ImageView& bw = level_bw.create(src.cols, src.rows, 1);
+    level_boxes.clear();
+    size_t candidates = 0;
+    if (config_.coarse_level_discovery) {
+        // blobs of the coarse mask, then full resolution blobs inside their windows only
+        const int scale = LEVEL_DISCOVERY_SCALE;
+        ImageView& coarse = level_coarse.create((src.cols + scale - 1) / scale, (src.rows + scale - 1) / scale, 1);
+        gray_threshold_downscale(frame, bw_thres, scale, &coarse);
+        find_blobs(coarse, &level_blobs, &blob_scratch);
+        for (size_t i = 0; i < level_blobs.size(); i++) {
+            const Blob& icon = level_blobs[i];
+            // a coarse blob of n cells covers at most n * scale pixels, smaller ones can't hold a digit;
+            // larger ones are searched too, since max pooling merges a digit with clutter a pixel away
+            if (icon.height * scale < 12 || icon.width * scale < 4) {
+                continue;
+            }
+            const cv::Rect cells(icon.x * scale, icon.y * scale, icon.width * scale, icon.height * scale);
+            const cv::Rect window = cv::Rect((icon.x - 1) * scale, (icon.y - 1) * scale, (icon.width + 2) * scale, (icon.height + 2) * scale) &
+                                    cv::Rect(0, 0, src.cols, src.rows);
+            ImageView window_bw = bw.roi(window.x, window.y, window.width, window.height);
+            gray_threshold(frame.roi(window.x, window.y, window.width, window.height), bw_thres, &window_bw);
+            find_blobs(window_bw, &window_blobs, &window_scratch);
+            for (size_t j = 0; j < window_blobs.size(); j++) {
+                const Blob& blob = window_blobs[j];
+                // blobs cut by the window border belong to other icons or clutter
+                if ((blob.x == 0 && window.x > 0) || (blob.y == 0 && window.y > 0) ||
+                    (blob.x + blob.width == window.width && window.x + window.width < src.cols) ||
+                    (blob.y + blob.height == window.height && window.y + window.height < src.rows)) {
+                    continue;
+                }
+                // counted in the icon it lies in, not again in the windows of its neighbors
+                if (cells.contains(cv::Point(window.x + blob.x, window.y + blob.y)) &&
+                    cells.contains(cv::Point(window.x + blob.x + blob.width - 1, window.y + blob.y + blob.height - 1))) {
+                    candidates++;
+                }
+                add_digit_box(blob, window.x, window.y);
+            }
+        }
+        // a digit inside overlapping windows is searched once
+        std::sort(level_boxes.begin(), level_boxes.end(), box_above);
+        level_boxes.erase(std::unique(level_boxes.begin(), level_boxes.end()), level_boxes.end());
+    } else {
+        if (parallel_level() == PARALLEL_IN_FRAME && cv::getNumThreads() > 1) {
+            // stripes on the pool, joined at their seams into the blobs of the whole frame
+            const int stripes = (src.rows + LEVEL_STRIPE_ROWS - 1) / LEVEL_STRIPE_ROWS;
+            if (level_stripes.size() < static_cast<size_t>(stripes)) {
+                level_stripes.resize(stripes);
+            }
+            cv::parallel_for_(cv::Range(0, stripes), LevelStripeBody(frame, bw, bw_thres, &level_stripes));
+            merge_stripe_blobs(level_stripes, stripes, &level_blobs, &blob_scratch);
+        } else {
+            gray_threshold(frame, bw_thres, &bw);
+            find_blobs(bw, &level_blobs, &blob_scratch);
+        }
+        for (size_t i = 0; i < level_blobs.size(); i++) {
+            add_digit_box(level_blobs[i], 0, 0);
+        }
+        candidates = level_blobs.size();
+    }
+    cv::Mat src_bw(bw.height, bw.width, CV_8UC1, bw.data, bw.stride);
+
+    // the whole frame as one region, or level icons, in planned order when there is a plan
+    const std::vector<cv::Rect>* boxes = &level_boxes;
+    level_regions.clear();
+    if (plan) {
+        plan->deferred->clear();
+    }
+    if (plan || config_.level_badge_prefilter) {
+        order_level_regions(plan, &level_boxes, &ordered_boxes, &level_regions);
+        boxes = &ordered_boxes;
+    } else {
+        LevelRegion frame_region = {2, 0, level_boxes.size(), cv::Rect()};
+        level_regions.push_back(frame_region);
+    }
+    if (digit_boxes) {
+        *digit_boxes = *boxes;
+    }
+    for (size_t r = 0; r < level_regions.size(); r++) {
+        const LevelRegion& region = level_regions[r];
+        // the first region is always searched, a frame makes progress however late it starts
+        if (plan && r > 0 && cv::getTickCount() > plan->deadline) {
+            for (; r < level_regions.size(); r++) {
+                plan->deferred->push_back(level_regions[r].rect);
+            }
+            break;
+        }
+        // icons without a badge ring are dropped before their digits are checked or matched
+        if (config_.level_badge_prefilter && !has_level_badge(frame, region.rect)) {
+            continue;
+        }
+        for (size_t i = region.first; i < region.first + region.count; i++) {
+            const cv::Rect& number_box = (*boxes)[i];
+            if (!is_black_white(src(number_box))) {
+                continue;
+            }
+            double error;
+            int number_detected = detect_number_roi(&src_bw, number_box, number_samples, avg_err_thres, glyph_bank, &error);
+            if (number_detected != -1) {
+                rect_num_vec->push_back(std::pair<cv::Point, int>(cv::Point(number_box.x, number_box.y), number_detected));
+                rect_err_vec->push_back(error);
+            }
+        }
+    }
+    return candidates;
+}
+
+void GameVideoAnalyzer::detect_levels(cv::Mat* src, const std::vector<cv::Mat>& number_samples, const cv::Mat& mask, const double& avg_err_thres, const size_t& bw_thres, GlyphBank* glyph_bank, std::vector<LevelDetection>* detections, size_t* candidates,
+                                      const LevelSearchPlan* plan) const {
+    static thread_local std::vector<std::pair<cv::Point, int>> rect_num_vec;   // [yyyxxxx] coordinate and number detected
+    static thread_local std::vector<double> rect_err_vec;    // template error of each number detected
+    static thread_local std::vector<bool> is_single_digit;
+    static thread_local std::vector<cv::Rect> digit_boxes;   // drawn by debug display
+    rect_num_vec.clear();
+    rect_err_vec.clear();
+    detections->clear();
+    // debug display searches like the headless path and only draws what it considered
+    size_t blobs = find_level_digits(*src, number_samples, mask, avg_err_thres, bw_thres, glyph_bank, plan, &rect_num_vec, &rect_err_vec,
+                                     config_.display ? &digit_boxes : NULL);
+    if (candidates) {
+        *candidates = blobs;
+    }
+    cv::Mat src_bw_display;
+    if (config_.display) {
+        cv::Mat src_gray, src_bw;
+        cv::cvtColor(*src, src_gray, cv::COLOR_BGR2GRAY);
+        cv::threshold(src_gray, src_bw, bw_thres, 255, cv::THRESH_BINARY);
+        cv::cvtColor(src_bw, src_bw_display, cv::COLOR_GRAY2BGR);
+        // cv::imwrite("gray.bmp", src_gray);
+        // cv::imwrite("bw.bmp", src_bw);
+
+        std::vector<std::vector<cv::Point>> contours_mask;
+        cv::findContours(mask, contours_mask, cv::RETR_LIST, cv::CHAIN_APPROX_NONE);
+        for (size_t i = 0; i < contours_mask.size(); i++) {
+            cv::drawContours(src_bw_display, contours_mask, i, cv::Scalar(0, 255, 255));
+        }
+        // digit boxes of the right size outside the mask in green, the ones read as a number in red
+        for (size_t i = 0; i < digit_boxes.size(); i++) {
+            cv::rectangle(src_bw_display, digit_boxes[i], cv::Scalar(0, 255, 0), 1);
+        }
+        for (size_t i = 0; i < rect_num_vec.size(); i++) {
+            for (size_t j = 0; j < digit_boxes.size(); j++) {
+                if (digit_boxes[j].tl() == rect_num_vec[i].first) {
+                    cv::rectangle(src_bw_display, digit_boxes[j], cv::Scalar(0, 0, 255), 1);
+                }
+            }
+        }
+    }
+
+    // for (size_t i = 0; i < rect_num_vec.size(); i++) {
+    //     std::cout << i << ": " << rect_num_vec[i].first << ", " << rect_num_vec[i].second << std::endl;
+    // }
+
+    // detect numbers in the same level icon
+    // TODO: sometimes only one of the two digits are detected,
+    // to alleviate this case, try once more to detect number from a small roi of every single digit.
+    is_single_digit.assign(rect_num_vec.size(), true);
+    for (size_t i = 0; i < rect_num_vec.size(); i++) {
+        if (!is_single_digit[i]) {
+            continue;
+        }
+        // for (size_t k = 0; k < is_single_digit.size(); k++) {
+        //     std::cout << is_single_digit[k];
+        // }
+        // std::cout << std::endl;
+        // std::cout << "i = " << i << std::endl;
+        cv::Point p1 = rect_num_vec[i].first;
+        int num1 = rect_num_vec[i].second;
+        for (size_t j = i + 1; j < rect_num_vec.size(); j++) {
+            // std::cout << "j = " << j << std::endl;
+            cv::Point p2 = rect_num_vec[j].first;
+            int num2 = rect_num_vec[j].second;
+            if (abs(p1.y - p2.y) < 3 && abs(p1.x - p2.x) < 15 && abs(p1.x - p2.x) > 8) {
+                int hero_level = (p1.x > p2.x) ? num1 + 10 * num2 : num2 + 10 * num1;
+                // std::cout << hero_level;
+                // restrict valid hero level lte 15
+                if (hero_level <= 15) {
+                    LevelDetection detection = {p1.x > p2.x ? p1 : p2, hero_level, std::max(rect_err_vec[i], rect_err_vec[j])};
+                    detections->push_back(detection);
+                    is_single_digit[i] = false;
+                    is_single_digit[j] = false;
+                    break;
+                }
+            }
+        }
+        if (is_single_digit[i] && num1 > 0) {
+            LevelDetection detection = {p1, num1, rect_err_vec[i]};
+            detections->push_back(detection);
+        }
+    }
+
+    if (config_.display) {
+        cv::namedWindow("icon");
+        cv::imshow("icon", src_bw_display);
+        // cv::waitKey(0);
+    }
+}
+
+void GameVideoAnalyzer::associate_heroes(const std::vector<LevelDetection>& detections, StreamState* stream, std::vector<HeroStatus>* hero_status_list, const int& ts) const {
+    for (size_t i = 0; i < detections.size(); i++) {
+        assign_hero(detections[i].level, detections[i].position, stream, hero_status_list, ts);
+    }
+
+    if (stream->is_heroes_list_initialized == false) {
+        stream->is_heroes_list_initialized = true;
+    }
+    if (!config_.display) {
+        return;
+    }
+    std::cout << "Current heroes list:" << std::endl;
+    std::cout << "Id\tLevel\tPosition\tLast updated\t\tAppearances" << std::endl;
+    for (size_t i = 0; i < stream->heroes_list.size(); i++) {
+        std::cout << stream->heroes_list[i].hero_id << '\t';
+        std::cout << stream->heroes_list[i].level << '\t';
+        std::cout << stream->heroes_list[i].position << '\t';
+        std::cout << stream->last_updated[i] << '\t' << '\t';
+        std::cout << stream->appearances[i] << std::endl;
+    }
+}
+
+void GameVideoAnalyzer::track_hero(cv::Mat* src, StreamState* stream, std::vector<HeroStatus>* hero_status_list, const int& ts, const std::vector<cv::Mat>& number_samples, const cv::Mat& mask, const double& avg_err_thres, const size_t& bw_thres) const {
+    int64 start = cv::getTickCount();
+    GlyphBank* glyph_bank = config_.glyph_adaptation ? stream->glyph_bank() : NULL;
+    if (config_.level_deadline_ms <= 0 || config_.display) {
+        stream->deferred_regions.clear();
+        detect_levels(src, number_samples, mask, avg_err_thres, bw_thres, glyph_bank, &stream->level_detections, &stream->level_candidates);
+    } else {
+        static thread_local std::vector<cv::Rect> deferred;
+        LevelSearchPlan plan = {start + static_cast<int64>(config_.level_deadline_ms * cv::getTickFrequency() / 1000.0),
+                                config_.tracker_params.merge_dist, &stream->heroes_list, &stream->deferred_regions, &deferred};
+        detect_levels(src, number_samples, mask, avg_err_thres, bw_thres, glyph_bank, &stream->level_detections, &stream->level_candidates, &plan);
+        stream->deferred_regions.swap(deferred);
+    }
+    associate_heroes(stream->level_detections, stream, hero_status_list, ts);
+}
+
+static const char* track_state_name(const TrackState& state) {
+    static const char* names[] = {"tentative", "confirmed", "lost"};
+    return names[state];
+}
+
+void GameVideoAnalyzer::delete_inactive_heroes(StreamState* stream, const int& ts, const int& inactive_time, const int& num_app) const {
+    std::vector<HeroStatus>& heroes_list = stream->heroes_list;
+    std::vector<int>& last_updated = stream->last_updated;
+    std::vector<int>& appearances = stream->appearances;
+    std::vector<TrackState>& track_states = stream->track_states;
+    // heroes kept are compacted to the front, in order
+    size_t kept = 0;
+    for (size_t i = 0; i < heroes_list.size(); i++) {
+        const int missing = ts - last_updated[i];
+        if (missing > inactive_time && track_states[i] == TRACK_TENTATIVE && appearances[i] < num_app) {
+            if (config_.display) {
+                std::cout << "Deleted hero id " << heroes_list[i].hero_id << " from list, last update at " << last_updated[i] << "ms with " << appearances[i] << " appearance(s)" << std::endl;
+            }
+            continue;
+        }
+        if (missing >= config_.tracker_params.retrieve_ms) {
+            // assign_hero would not continue it any more
+            ArchivedHero archived = {heroes_list[i].hero_id, heroes_list[i].level, heroes_list[i].position, last_updated[i], appearances[i]};
+            if (stream->hero_archive.size() < HERO_ARCHIVE_SIZE) {
+                stream->hero_archive.push_back(archived);
+            } else {
+                stream->hero_archive[stream->hero_archive_next] = archived;
+            }
+            stream->hero_archive_next = (stream->hero_archive_next + 1) % HERO_ARCHIVE_SIZE;
+            stream->heroes_archived++;
+            if (config_.display) {
+                std::cout << "Archived hero id " << heroes_list[i].hero_id << ", last update at " << last_updated[i] << "ms with " << appearances[i] << " appearance(s)" << std::endl;
+            }
+            continue;
+        }
+        if (missing > inactive_time) {
+            track_states[i] = TRACK_LOST;
+        }
+        if (kept != i) {
+            heroes_list[kept] = heroes_list[i];
+            last_updated[kept] = last_updated[i];
+            appearances[kept] = appearances[i];
+            track_states[kept] = track_states[i];
+        }
+        kept++;
+    }
+    heroes_list.resize(kept);
+    last_updated.resize(kept);
+    appearances.resize(kept);
+    track_states.resize(kept);
+    if (!config_.display) {
+        return;
+    }
+    std::cout << "Current heroes list after deleting inactive heroes (" << stream->heroes_archived << " archived):" << std::endl;
+    std::cout << "Id\tLevel\tPosition\tLast updated\t\tAppearances\tState" << std::endl;
+    for (size_t i = 0; i < heroes_list.size(); i++) {
+        std::cout << heroes_list[i].hero_id << '\t';
+        std::cout << heroes_list[i].level << '\t';
+        std::cout << heroes_list[i].position << '\t';
+        std::cout << last_updated[i] << '\t' << '\t';
+        std::cout << appearances[i] << '\t' << '\t';
+        std::cout << track_state_name(track_states[i]) << std::endl;
+    }
+}
+
+
+// record elapsed time of one stage and restart the tick counter
+static inline void mark_stage(double* stage_ms, const int& stage, int64* tick) {
+    int64 tock = cv::getTickCount();
+    if (stage_ms) {
+        stage_ms[stage] = (tock - *tick) * 1000.0 / cv::getTickFrequency();
+    }
+    *tick = tock;
+}
+
+// detects cooldown numbers of a range of spell/skill icons
+class CooldownBody : public cv::ParallelLoopBody {
+  private:
+    const GameVideoAnalyzer* analyzer_;
+    cv::Mat* src_;
+    const std::vector<cv::Mat>* number_samples_;
+    double avg_err_thres_;
+    size_t bw_thres_;
+    GlyphBank* glyph_bank_;
+    int** cooldowns_;
+
+  public:
+    CooldownBody(const GameVideoAnalyzer* analyzer, cv::Mat* src, const std::vector<cv::Mat>* number_samples, const double& avg_err_thres, const size_t& bw_thres,
+                 GlyphBank* glyph_bank, int** cooldowns)
+        : analyzer_(analyzer), src_(src), number_samples_(number_samples), avg_err_thres_(avg_err_thres), bw_thres_(bw_thres), glyph_bank_(glyph_bank), cooldowns_(cooldowns) {}
+
+    void operator()(const cv::Range& range) const {
+        for (int i = range.start; i < range.end; i++) {
+            const double radius = analyzer_->cooldown_radius(i);
+            const cv::Point& center = COOLDOWN_CENTERS[i];
+            cv::Mat src_roi = (*src_)(cv::Rect(center.x - radius * 0.8, center.y - radius * 0.4, radius * 1.6, radius * 0.8));
+            *cooldowns_[i] = analyzer_->detect_number_fixed(&src_roi, *number_samples_, avg_err_thres_, bw_thres_, cv::Vec4b(0, 0, 0, 0), glyph_bank_);
+        }
+    }
+};
+
+void GameVideoAnalyzer::process_frame(cv::Mat* src, const int& ts, const NumberSamples& samples, StreamState* stream, FrameStatus* status, double* stage_ms) const {
+    // configurations
+    const double avg_err_thres_largenum = 0.3;
+    const double avg_err_thres_money = 0.99;
+    const size_t bw_thres_largenum = 150;
+    const size_t bw_thres_smallnum = 210;
+    const size_t bw_thres_level = 180;
+
+    int* cooldowns[NUM_COOLDOWNS] = {&status->spell1_cd, &status->spell2_cd, &status->spell3_cd,
+                         &status->skill1_cd, &status->skill2_cd, &status->skill3_cd, &status->skill4_cd};
+    const char* cooldown_names[NUM_COOLDOWNS] = {"Spell 1", "Spell 2", "Spell 3", "Skill 1", "Skill 2", "Skill 3", "Skill 4"};
+
+    status->ts = ts;
+    stream->last_frame_duplicate = false;
+    int64 tick = cv::getTickCount();
+
+    // repeated frames of upsampled or VFR sources, compared before anything is drawn on the frame
+    if (config_.dedup_tolerance >= 0) {
+        std::vector<unsigned char>& thumbnail = stream->frame_thumbnail;
+        thumbnail.resize(DEDUP_GRID_WIDTH * DEDUP_GRID_HEIGHT);
+        luma_thumbnail(image_view(*src), DEDUP_GRID_WIDTH, DEDUP_GRID_HEIGHT, 2, &thumbnail[0]);
+        if (!stream->analyzed_thumbnail.empty() &&
+            max_abs_diff(&thumbnail[0], &stream->analyzed_thumbnail[0], thumbnail.size()) <= config_.dedup_tolerance) {
+            *status = stream->analyzed_status;
+            status->ts = ts;
+            stream->duplicate_frames++;
+            stream->last_frame_duplicate = true;
+            if (stage_ms) {
+                std::fill(stage_ms, stage_ms + STAGE_COUNT, 0.0);
+            }
+            if (config_.display) {
+                std::cout << "Duplicate frame, reusing the status at " << stream->analyzed_status.ts << "ms" << std::endl;
+            }
+            return;
+        }
+        // compare later frames with this one rather than their predecessor, so slow fades don't drift
+        stream->analyzed_thumbnail.swap(thumbnail);
+    }
+
+    // Use flexible location number detection for level icon, into the status' own list so its capacity is reused
+    status->hero_list.clear();
+    track_hero(src, stream, &status->hero_list, ts, samples.level, samples.icon_mask, 0.3, bw_thres_level);
+    mark_stage(stage_ms, STAGE_TRACK_HERO, &tick);
+
+    // prune heroes list
+    delete_inactive_heroes(stream, ts, config_.tracker_params.inactive_ms, config_.tracker_params.min_appearances);
+    mark_stage(stage_ms, STAGE_DELETE_INACTIVE, &tick);
+
+    // Use exact coordiates for spell and skill icon
+    GlyphBank* glyph_bank = config_.glyph_adaptation ? stream->glyph_bank() : NULL;
+    int num;
+    cv::Mat src_roi;
+
+    // money number detection
+    src_roi = (*src)(MONEY_ROI);
+    if (config_.display) {
+        cv::rectangle(*src, MONEY_ROI, cv::Scalar(0, 0, 255), 1);
+    }
+    num = detect_number_fixed(&src_roi, samples.money, avg_err_thres_money, bw_thres_smallnum, cv::Vec4b(10, 16, 3, 11), glyph_bank);
+    if (config_.display) {
+        std::cout << "Current money: " << num << std::endl;
+    }
+    status->money = num;
+    mark_stage(stage_ms, STAGE_MONEY, &tick);
+
+    // cooldown ROIs don't overlap, batches of them run in parallel unless debug windows are shown
+    // or the pool already runs whole frames of several tasks
+    CooldownBody cooldown_body(this, src, &samples.cooldown, avg_err_thres_largenum, bw_thres_largenum, glyph_bank, cooldowns);
+    int stripes = (NUM_COOLDOWNS + config_.roi_batch - 1) / config_.roi_batch;
+    if (config_.display || stripes <= 1 || parallel_level() != PARALLEL_IN_FRAME) {
+        cooldown_body(cv::Range(0, NUM_COOLDOWNS));
+    } else {
+        cv::parallel_for_(cv::Range(0, NUM_COOLDOWNS), cooldown_body, stripes);
+    }
+    // annotations are only for the debug window, drawing thick circles allocates
+    for (size_t i = 0; i < NUM_COOLDOWNS && config_.display; i++) {
+        cv::circle(*src, COOLDOWN_CENTERS[i], cooldown_radius(i), cv::Scalar(0, 0, 255), 3);
+        std::cout << cooldown_names[i] << " cooldown: " << *cooldowns[i] << std::endl;
+    }
+    mark_stage(stage_ms, STAGE_COOLDOWN, &tick);
+
+    // Use Hough circle detection for virtual joystick
+    double joystick_angle;
+    double dist = -1;
+    joystick_angle = estimate_joystick_angle(src, &dist);
+    if (dist >= 0) {
+        // running mean and squared deviations (Welford), constant size however long the stream
+        stream->dist_samples++;
+        const double delta = dist - stream->dist_mean;
+        stream->dist_mean += delta / stream->dist_samples;
+        stream->dist_m2 += delta * (dist - stream->dist_mean);
+    }
+    if (config_.display) {
+        std::cout << "Joystick angle: " << joystick_angle << std::endl;
+    }
+    status->joystick_angle = joystick_angle;
+    mark_stage(stage_ms, STAGE_JOYSTICK, &tick);
+
+    if (config_.dedup_tolerance >= 0) {
+        stream->analyzed_status = *status;
+    }
+}
+
+void apply_pipeline_params(const PipelineParams& params, GameVideoAnalyzer* analyzer) {
+    // the read-ahead decoder runs beside the pool
+    use_threads(PARALLEL_IN_FRAME, params.num_threads, params.read_ahead > 0 ? 1 : 0);
+    analyzer->set_roi_batch(params.roi_batch);
+}
+
+const char* frame_stage_name(const int& stage) {
+    static const char* names[STAGE_COUNT] = {"track_hero", "delete_inactive", "money", "cooldown", "joystick"};
+    if (stage < 0 || stage >= STAGE_COUNT) {
+        return "unknown";
+    }
+    return names[stage];
+}
+
+int parse_frame_timestamp(const std::string& filename) {
+    size_t found0 = filename.find_last_of("_");
+    size_t found1 = filename.find_last_of(".");
+    return static_cast<int>(std::atof(filename.substr(found0 + 1, found1).c_str()) * 1000.0);
+}
+
+static bool load_sample_file(const std::string& filename, cv::Mat* sample) {
+    std::cout << "Loading number sample from file " << filename << std::endl;
+    *sample = cv::imread(filename, CV_LOAD_IMAGE_GRAYSCALE);
+    if (!sample->data) {
+        std::cerr << "Load file " << filename << " failed!\n";
+        return false;
+    }
+    return true;
+}
+
+bool load_number_samples(const std::string& folder, NumberSamples* samples) {
+    const char* prefixes[3] = {"", "m", "l"};
+    std::vector<cv::Mat>* banks[3] = {&samples->cooldown, &samples->money, &samples->level};
+    for (size_t b = 0; b < 3; b++) {
+        banks[b]->clear();
+        for (size_t i = 0; i < 10; i++) {
+            cv::Mat num_sample;
+            if (!load_sample_file(folder + "/" + prefixes[b] + std::to_string(i) + ".bmp", &num_sample)) {
+                return false;
+            }
+            banks[b]->push_back(num_sample);
+        }
+    }
+
+    // load mask.bmp used in level icon recognizion
+    std::cout << "Loading mask file." << std::endl;
+    return load_sample_file(folder + "/mask.bmp", &samples->icon_mask);
+}
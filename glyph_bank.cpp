@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cmath>
+#include "glyph_bank.h"
+
+GlyphBank::GlyphBank(const size_t& max_per_digit, const double& match_thres, const double& learn_thres, const double& learn_margin)
+    : max_per_digit_(std::max<size_t>(1, max_per_digit)), match_thres_(match_thres), learn_thres_(learn_thres), learn_margin_(learn_margin) {
+    clear();
+}
+
+static inline ImageView variant_view(const std::vector<unsigned char>& pixels, const int& width, const int& height) {
+    ImageView view = {const_cast<unsigned char*>(&pixels[0]), width, height, 1, static_cast<size_t>(width)};
+    return view;
+}
+
+int GlyphBank::match(const void* font, const ImageView& binary, const int& x, const int& y, const int& w, const int& h, double* error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.lookups++;
+    int best = -1;
+    double best_error = match_thres_;
+    for (size_t i = 0; i < variants_.size(); i++) {
+        const Variant& variant = variants_[i];
+        if (variant.font != font) {
+            continue;
+        }
+        // same h/w ratio gate as the stock samples
+        double ratio = (static_cast<double>(h) / w) / (static_cast<double>(variant.height) / variant.width);
+        if (ratio > 1.3 || ratio < 0.8) {
+            continue;
+        }
+        double err = template_error(binary, x, y, w, h, variant_view(variant.pixels, variant.width, variant.height));
+        if (err <= best_error) {
+            best_error = err;
+            best = static_cast<int>(i);
+            if (err == 0) {
+                break;
+            }
+        }
+    }
+    if (best < 0) {
+        return -1;
+    }
+    stats_.hits++;
+    variants_[best].hits++;
+    // keep the most used variants in front, they usually match exactly and end the scan
+    while (best > 0 && variants_[best - 1].hits < variants_[best].hits) {
+        std::swap(variants_[best - 1], variants_[best]);
+        best--;
+    }
+    if (error) {
+        *error = best_error;
+    }
+    return variants_[best].digit;
+}
+
+void GlyphBank::learn(const void* font, const int& digit, const double& error, const double& next_error,
+                      const ImageView& binary, const int& x, const int& y, const int& w, const int& h,
+                      const int& sample_width, const int& sample_height) {
+    // exact matches of the stock samples teach nothing
+    if (error == 0 || error > learn_thres_ || next_error - error < learn_margin_) {
+        return;
+    }
+    Variant variant = {font, digit, sample_width, sample_height, 1, std::vector<unsigned char>(sample_width * sample_height)};
+    // nearest-neighbor scaled box, the offsets template_error compares against
+    for (int gy = 0; gy < sample_height; gy++) {
+        const unsigned char* src = binary.row(y + std::min(static_cast<int>(std::floor(gy * static_cast<double>(h) / sample_height)), h - 1));
+        for (int gx = 0; gx < sample_width; gx++) {
+            variant.pixels[gy * sample_width + gx] = src[x + std::min(static_cast<int>(std::floor(gx * static_cast<double>(w) / sample_width)), w - 1)];
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    int least_used = -1;
+    for (size_t i = 0; i < variants_.size(); i++) {
+        const Variant& other = variants_[i];
+        if (other.font != font || other.digit != digit) {
+            continue;
+        }
+        if (other.width == sample_width && other.height == sample_height &&
+            template_error(variant_view(other.pixels, other.width, other.height), 0, 0, other.width, other.height,
+                           variant_view(variant.pixels, sample_width, sample_height)) <= match_thres_) {
+            return;    // a parallel task learned the same glyph
+        }
+        count++;
+        if (least_used < 0 || other.hits <= variants_[least_used].hits) {
+            least_used = static_cast<int>(i);
+        }
+    }
+    stats_.learned++;
+    if (count < max_per_digit_) {
+        variants_.push_back(variant);
+    } else {
+        // bounded per digit and font, the least used variant makes room
+        variants_[least_used] = variant;
+        variants_[least_used].hits = 1;
+    }
+}
+
+void GlyphBank::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    variants_.clear();
+    GlyphBankStats stats = {0, 0, 0, 0};
+    stats_ = stats;
+}
+
+GlyphBankStats GlyphBank::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    GlyphBankStats stats = stats_;
+    stats.variants = variants_.size();
+    return stats;
+}
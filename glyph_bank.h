@@ -0,0 +1,59 @@
+#ifndef GLYPH_BANK_H
+#define GLYPH_BANK_H
+
+#include <mutex>
+#include "kernels.h"
+
+// Per-video variants of the digit glyphs, learned online.
+// Glyph rendering drifts with resolution, encoder and game patch, so a video's digits match the
+// stock samples only approximately. Confident recognitions are stored as variant prototypes at
+// the sample size, bounded per digit and font; lookups try them before the stock samples, so
+// after the first seconds of a video most digits match a variant exactly or nearly so.
+// Fonts are told apart by an opaque key, e.g. the pixels of their first stock sample.
+// Lookups and learning lock, cooldown ROIs are recognized in parallel.
+
+struct GlyphBankStats {
+    size_t lookups;
+    size_t hits;       // lookups answered by a variant
+    size_t learned;    // variants added, replacements included
+    size_t variants;
+};
+
+class GlyphBank {
+  private:
+    struct Variant {
+        const void* font;
+        int digit;
+        int width;
+        int height;
+        size_t hits;
+        std::vector<unsigned char> pixels;
+    };
+
+    size_t max_per_digit_;
+    double match_thres_;
+    double learn_thres_;
+    double learn_margin_;
+    std::vector<Variant> variants_;    // most used first
+    GlyphBankStats stats_;
+    mutable std::mutex mutex_;
+
+  public:
+    // a variant answers a lookup within match_thres; a recognition is learned when its error is
+    // below learn_thres and the next best digit is at least learn_margin worse
+    GlyphBank(const size_t& max_per_digit = 3, const double& match_thres = 0.05, const double& learn_thres = 0.12, const double& learn_margin = 0.15);
+
+    // digit of the best variant of the font within match_thres of the box, -1 if none
+    int match(const void* font, const ImageView& binary, const int& x, const int& y, const int& w, const int& h, double* error = NULL);
+
+    // learns the box as a variant of digit when the recognition is confident enough;
+    // sample_width/height is the stock sample size the box is scaled to
+    void learn(const void* font, const int& digit, const double& error, const double& next_error,
+               const ImageView& binary, const int& x, const int& y, const int& w, const int& h,
+               const int& sample_width, const int& sample_height);
+
+    void clear();
+    GlyphBankStats stats() const;
+};
+
+#endif
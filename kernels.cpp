@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <stdint.h>
+#include "kernels.h"
+
+// cv::cvtColor fixed point constants, BGR2GRAY weights and HSV saturation divisor
+static const int GRAY_SHIFT = 14;
+static const int GRAY_B = 1868;
+static const int GRAY_G = 9617;
+static const int GRAY_R = 4899;
+static const int HSV_SHIFT = 12;
+
+ImageBuffer::ImageBuffer() {
+    ImageView empty = {NULL, 0, 0, 1, 0};
+    view_ = empty;
+}
+
+ImageView& ImageBuffer::create(const int& width, const int& height, const int& channels) {
+    const size_t size = static_cast<size_t>(width) * height * channels;
+    if (pixels_.size() < size) {
+        pixels_.resize(size);
+    }
+    ImageView view = {pixels_.empty() ? NULL : &pixels_[0], width, height, channels, static_cast<size_t>(width) * channels};
+    view_ = view;
+    return view_;
+}
+
+void gray_threshold(const ImageView& bgr, const int& thres, ImageView* binary) {
+    for (int y = 0; y < bgr.height; y++) {
+        const unsigned char* src = bgr.row(y);
+        unsigned char* dst = binary->row(y);
+        for (int x = 0; x < bgr.width; x++, src += 3) {
+            int gray = (src[0] * GRAY_B + src[1] * GRAY_G + src[2] * GRAY_R + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT;
+            dst[x] = gray > thres ? 255 : 0;
+        }
+    }
+}
+
+void gray_threshold_downscale(const ImageView& bgr, const int& thres, const int& scale, ImageView* coarse) {
+    for (int cy = 0; cy < coarse->height; cy++) {
+        unsigned char* dst = coarse->row(cy);
+        std::fill(dst, dst + coarse->width, 0);
+        const int y_end = std::min(bgr.height, (cy + 1) * scale);
+        for (int y = cy * scale; y < y_end; y++) {
+            const unsigned char* src = bgr.row(y);
+            int x = 0;
+            for (int cx = 0; cx < coarse->width; cx++) {
+                const int x_end = std::min(bgr.width, x + scale);
+                for (; x < x_end; x++, src += 3) {
+                    int gray = (src[0] * GRAY_B + src[1] * GRAY_G + src[2] * GRAY_R + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT;
+                    if (gray > thres) {
+                        dst[cx] = 255;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static inline int find_root(std::vector<int>* parent, int i) {
+    while ((*parent)[i] != i) {
+        (*parent)[i] = (*parent)[(*parent)[i]];
+        i = (*parent)[i];
+    }
+    return i;
+}
+
+// 8-connectivity: rows touch when they overlap after widening by one pixel;
+// joins runs [begin, end) with the runs [prev_begin, prev_end) of the row above
+static void join_rows(const std::vector<BlobScratch::Run>& runs, std::vector<int>* parent, const size_t& prev_begin, const size_t& prev_end,
+                      const size_t& begin, const size_t& end) {
+    size_t j = prev_begin;
+    for (size_t i = begin; i < end; i++) {
+        const BlobScratch::Run& run = runs[i];
+        while (j < prev_end && runs[j].x1 < run.x0) {
+            j++;
+        }
+        for (size_t k = j; k < prev_end && runs[k].x0 <= run.x1; k++) {
+            int a = find_root(parent, run.label);
+            int b = find_root(parent, runs[k].label);
+            if (a != b) {
+                (*parent)[std::max(a, b)] = std::min(a, b);
+            }
+        }
+    }
+}
+
+void label_runs(const ImageView& binary, const int& first_row, const int& end_row, BlobScratch* stripe) {
+    std::vector<BlobScratch::Run>& runs = stripe->runs;
+    std::vector<int>& parent = stripe->parent;
+    runs.clear();
+    parent.clear();
+    stripe->first_row = first_row;
+    stripe->end_row = end_row;
+
+    // runs of nonzero pixels, each joined with the runs of the row above it touches
+    size_t prev_begin = 0, prev_end = 0;
+    for (int y = first_row; y < end_row; y++) {
+        const unsigned char* row = binary.row(y);
+        const size_t row_begin = runs.size();
+        for (int x = 0; x < binary.width;) {
+            if (!row[x]) {
+                x++;
+                continue;
+            }
+            BlobScratch::Run run = {y, x, x, static_cast<int>(runs.size())};
+            while (x < binary.width && row[x]) {
+                x++;
+            }
+            run.x1 = x;
+            runs.push_back(run);
+            parent.push_back(run.label);
+        }
+        join_rows(runs, &parent, prev_begin, prev_end, row_begin, runs.size());
+        prev_begin = row_begin;
+        prev_end = runs.size();
+    }
+}
+
+// blobs of labelled runs, in raster order of their first pixel
+static void collect_blobs(BlobScratch* scratch, std::vector<Blob>* blobs) {
+    std::vector<BlobScratch::Run>& runs = scratch->runs;
+    std::vector<int>& parent = scratch->parent;
+    std::vector<int>& blob_of_root = scratch->blob_of_root;
+    blobs->clear();
+    blob_of_root.assign(runs.size(), -1);
+    for (size_t i = 0; i < runs.size(); i++) {
+        const BlobScratch::Run& run = runs[i];
+        int root = find_root(&parent, run.label);
+        if (blob_of_root[root] < 0) {
+            blob_of_root[root] = static_cast<int>(blobs->size());
+            Blob blob = {run.x0, run.y, run.x1 - run.x0, 1, 0};
+            blobs->push_back(blob);
+        }
+        Blob& blob = (*blobs)[blob_of_root[root]];
+        int x_end = std::max(blob.x + blob.width, run.x1);
+        blob.x = std::min(blob.x, run.x0);
+        blob.width = x_end - blob.x;
+        blob.height = run.y - blob.y + 1;
+        blob.area += run.x1 - run.x0;
+    }
+}
+
+void find_blobs(const ImageView& binary, std::vector<Blob>* blobs, BlobScratch* scratch) {
+    label_runs(binary, 0, binary.height, scratch);
+    collect_blobs(scratch, blobs);
+}
+
+void merge_stripe_blobs(const std::vector<BlobScratch>& stripes, const size_t& count, std::vector<Blob>* blobs, BlobScratch* merged) {
+    std::vector<BlobScratch::Run>& runs = merged->runs;
+    std::vector<int>& parent = merged->parent;
+    runs.clear();
+    parent.clear();
+    // last row runs of the previous stripe
+    size_t prev_begin = 0, prev_end = 0;
+    int prev_end_row = -1;
+    for (size_t s = 0; s < count; s++) {
+        const BlobScratch& stripe = stripes[s];
+        const int offset = static_cast<int>(runs.size());
+        for (size_t i = 0; i < stripe.runs.size(); i++) {
+            BlobScratch::Run run = stripe.runs[i];
+            run.label += offset;
+            runs.push_back(run);
+            parent.push_back(stripe.parent[i] + offset);
+        }
+        // first row runs of this stripe, joined across the seam
+        size_t first_end = offset;
+        while (first_end < runs.size() && runs[first_end].y == stripe.first_row) {
+            first_end++;
+        }
+        if (prev_end_row == stripe.first_row) {
+            join_rows(runs, &parent, prev_begin, prev_end, offset, first_end);
+        }
+        prev_begin = prev_end = runs.size();
+        while (prev_begin > static_cast<size_t>(offset) && runs[prev_begin - 1].y == stripe.end_row - 1) {
+            prev_begin--;
+        }
+        prev_end_row = stripe.end_row;
+    }
+    collect_blobs(merged, blobs);
+}
+
+double template_error(const ImageView& binary, const int& x, const int& y, const int& w, const int& h, const ImageView& glyph) {
+    // source offsets of cv::resize INTER_NEAREST: floor(dst * src_size / dst_size)
+    const double scale_x = static_cast<double>(w) / glyph.width;
+    const double scale_y = static_cast<double>(h) / glyph.height;
+    // glyphs are a few pixels wide
+    int x_ofs[256];
+    const int glyph_width = std::min(glyph.width, 256);
+    for (int gx = 0; gx < glyph_width; gx++) {
+        x_ofs[gx] = x + std::min(static_cast<int>(std::floor(gx * scale_x)), w - 1);
+    }
+    int errors = 0;
+    for (int gy = 0; gy < glyph.height; gy++) {
+        const unsigned char* src = binary.row(y + std::min(static_cast<int>(std::floor(gy * scale_y)), h - 1));
+        const unsigned char* sample = glyph.row(gy);
+        for (int gx = 0; gx < glyph_width; gx++) {
+            const unsigned char value = src[x_ofs[gx]];
+            errors += (value == 0xff && sample[gx] == 0) || (value == 0 && sample[gx] == 0xff);
+        }
+    }
+    return static_cast<double>(errors) / (glyph_width * glyph.height);
+}
+
+// round((255 << HSV_SHIFT) / v) as in cv::cvtColor
+struct SaturationDivisor {
+    int table[256];
+    SaturationDivisor() {
+        table[0] = 0;
+        for (int v = 1; v < 256; v++) {
+            table[v] = static_cast<int>((255 << HSV_SHIFT) / static_cast<double>(v) + 0.5);
+        }
+    }
+};
+
+int count_saturated(const ImageView& bgr, const int& s_thres, const int& v_thres) {
+    static const SaturationDivisor saturation_divisor;
+    int count = 0;
+    for (int y = 0; y < bgr.height; y++) {
+        const unsigned char* p = bgr.row(y);
+        for (int x = 0; x < bgr.width; x++, p += 3) {
+            int v = std::max(p[0], std::max(p[1], p[2]));
+            if (v <= v_thres) {
+                continue;
+            }
+            int diff = v - std::min(p[0], std::min(p[1], p[2]));
+            int s = (diff * saturation_divisor.table[v] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+            count += s > s_thres;
+        }
+    }
+    return count;
+}
+
+void luma_thumbnail(const ImageView& bgr, const int& grid_width, const int& grid_height, const int& step, unsigned char* thumbnail) {
+    // thumbnails are a few dozen blocks wide
+    int sums[256], counts[256];
+    const int blocks = std::min(grid_width, 256);
+    const size_t pixel_step = static_cast<size_t>(step) * bgr.channels;
+    int y = 0;
+    for (int by = 0; by < grid_height; by++) {
+        const int y_end = static_cast<int>((by + 1) * static_cast<int64_t>(bgr.height) / grid_height);
+        std::fill(sums, sums + blocks, 0);
+        std::fill(counts, counts + blocks, 0);
+        for (; y < y_end; y += step) {
+            const unsigned char* p = bgr.row(y);
+            int bx = 0, x_end = bgr.width / blocks;
+            for (int x = 0; x < bgr.width; x += step, p += pixel_step) {
+                while (x >= x_end) {
+                    bx++;
+                    x_end = static_cast<int>((bx + 1) * static_cast<int64_t>(bgr.width) / blocks);
+                }
+                sums[bx] += (p[0] * GRAY_B + p[1] * GRAY_G + p[2] * GRAY_R + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT;
+                counts[bx]++;
+            }
+        }
+        for (int bx = 0; bx < blocks; bx++) {
+            thumbnail[by * blocks + bx] = static_cast<unsigned char>(counts[bx] > 0 ? (sums[bx] + counts[bx] / 2) / counts[bx] : 0);
+        }
+    }
+}
+
+int gray_at(const ImageView& bgr, const int& x, const int& y) {
+    if (x < 0 || y < 0 || x >= bgr.width || y >= bgr.height) {
+        return -1;
+    }
+    const unsigned char* p = bgr.row(y) + x * bgr.channels;
+    return (p[0] * GRAY_B + p[1] * GRAY_G + p[2] * GRAY_R + (1 << (GRAY_SHIFT - 1))) >> GRAY_SHIFT;
+}
+
+int max_abs_diff(const unsigned char* a, const unsigned char* b, const size_t& n) {
+    int diff = 0;
+    for (size_t i = 0; i < n; i++) {
+        diff = std::max(diff, std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i])));
+    }
+    return diff;
+}
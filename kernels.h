@@ -0,0 +1,107 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <vector>
+
+// OpenCV independent kernels for the per-frame hot paths: fused gray conversion and threshold,
+// connected blobs, binary template scoring, saturation counting and luma thumbnails.
+// They work on strided views of caller owned memory and allocate only when a caller provided
+// buffer has to grow, so the kernels themselves do not allocate in steady state. OpenCV stays at
+// the edges (decoding, resizing, the joystick's HoughCircles, drawing and debug windows), see
+// image_view() in game_video.h.
+
+// 8-bit image with interleaved channels, rows stride bytes apart
+struct ImageView {
+    unsigned char* data;
+    int width;
+    int height;
+    int channels;
+    size_t stride;
+
+    inline unsigned char* row(const int& y) const {
+        return data + y * stride;
+    }
+    // caller keeps the rectangle inside the view
+    inline ImageView roi(const int& x, const int& y, const int& w, const int& h) const {
+        ImageView view = {row(y) + x * channels, w, h, channels, stride};
+        return view;
+    }
+};
+
+// owns pixels for kernel outputs, capacity only grows
+class ImageBuffer {
+  private:
+    std::vector<unsigned char> pixels_;
+    ImageView view_;
+
+  public:
+    ImageBuffer();
+    ImageView& create(const int& width, const int& height, const int& channels);
+    inline const ImageView& view() const {
+        return view_;
+    }
+};
+
+// 8-connected component of nonzero pixels
+struct Blob {
+    int x;
+    int y;
+    int width;
+    int height;
+    int area;
+};
+
+// reusable working memory of find_blobs, or the labelled runs of one stripe, see label_runs
+struct BlobScratch {
+    struct Run {
+        int y;
+        int x0;
+        int x1;    // exclusive
+        int label;
+    };
+    std::vector<Run> runs;
+    std::vector<int> parent;
+    std::vector<int> blob_of_root;
+    int first_row;    // rows labelled
+    int end_row;
+};
+
+// BGR to gray with OpenCV's fixed point weights, then 255 where gray > thres else 0
+void gray_threshold(const ImageView& bgr, const int& thres, ImageView* binary);
+
+// gray_threshold at a scale times coarser grid: 255 where any pixel of the scale x scale block
+// (clipped at the borders) has gray > thres, so every blob of the full resolution mask falls
+// inside one blob of the coarse one; coarse is ceil(width / scale) x ceil(height / scale)
+void gray_threshold_downscale(const ImageView& bgr, const int& thres, const int& scale, ImageView* coarse);
+
+// blobs in raster order of their first pixel; unlike RETR_EXTERNAL contours, blobs inside
+// holes of other blobs are reported too
+void find_blobs(const ImageView& binary, std::vector<Blob>* blobs, BlobScratch* scratch);
+
+// the labelling of find_blobs restricted to rows [first_row, end_row), so stripes of one image can
+// be labelled on separate threads, each into its own scratch
+void label_runs(const ImageView& binary, const int& first_row, const int& end_row, BlobScratch* stripe);
+
+// blobs of count stripes labelled by label_runs, in order: runs touching across a seam are joined,
+// so the blobs are exactly those of find_blobs on the rows the stripes cover
+void merge_stripe_blobs(const std::vector<BlobScratch>& stripes, const size_t& count, std::vector<Blob>* blobs, BlobScratch* merged);
+
+// fraction of pixels differing between the box of binary, nearest-neighbor scaled to the
+// template size as cv::resize(INTER_NEAREST) does, and the binary template
+double template_error(const ImageView& binary, const int& x, const int& y, const int& w, const int& h, const ImageView& glyph);
+
+// pixels whose HSV saturation > s_thres and value > v_thres, same rounding as cv::cvtColor
+int count_saturated(const ImageView& bgr, const int& s_thres, const int& v_thres);
+
+// mean luma of grid_width (at most 256) x grid_height blocks, from every step-th pixel of every
+// step-th row; thumbnail receives grid_width * grid_height bytes
+void luma_thumbnail(const ImageView& bgr, const int& grid_width, const int& grid_height, const int& step, unsigned char* thumbnail);
+
+// gray level of one BGR pixel with the weights of gray_threshold, -1 outside the view
+int gray_at(const ImageView& bgr, const int& x, const int& y);
+
+// largest absolute difference of two byte arrays
+int max_abs_diff(const unsigned char* a, const unsigned char* b, const size_t& n);
+
+#endif
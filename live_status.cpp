@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstdlib>
+#include "live_status.h"
+#include "text_writer.h"
+
+void to_status_record(const FrameStatus& status, StatusRecord* record) {
+    record->ts = status.ts;
+    record->money = status.money;
+    record->joystick_angle = status.joystick_angle;
+    const int cooldowns[RING_COOLDOWNS] = {status.spell1_cd, status.spell2_cd, status.spell3_cd,
+                                           status.skill1_cd, status.skill2_cd, status.skill3_cd, status.skill4_cd};
+    std::copy(cooldowns, cooldowns + RING_COOLDOWNS, record->cooldowns);
+    record->hero_count = static_cast<uint32_t>(std::min<size_t>(status.hero_list.size(), RING_MAX_HEROES));
+    for (uint32_t i = 0; i < record->hero_count; i++) {
+        const HeroStatus& hero = status.hero_list[i];
+        RingHero ring_hero = {hero.hero_id, hero.position.x, hero.position.y, hero.level};
+        record->heroes[i] = ring_hero;
+    }
+}
+
+void to_frame_status(const StatusRecord& record, FrameStatus* status) {
+    status->ts = record.ts;
+    status->money = record.money;
+    status->joystick_angle = record.joystick_angle;
+    int* cooldowns[RING_COOLDOWNS] = {&status->spell1_cd, &status->spell2_cd, &status->spell3_cd,
+                                      &status->skill1_cd, &status->skill2_cd, &status->skill3_cd, &status->skill4_cd};
+    for (size_t i = 0; i < RING_COOLDOWNS; i++) {
+        *cooldowns[i] = record.cooldowns[i];
+    }
+    status->hero_list.clear();
+    for (uint32_t i = 0; i < std::min<uint32_t>(record.hero_count, RING_MAX_HEROES); i++) {
+        const RingHero& hero = record.heroes[i];
+        HeroStatus hero_status = {hero.hero_id, cv::Point(hero.x, hero.y), hero.level};
+        status->hero_list.push_back(hero_status);
+    }
+}
+
+LiveStatusPublisher::LiveStatusPublisher() : open_(false) {}
+
+bool LiveStatusPublisher::open(const std::string& path, const uint32_t& capacity) {
+    open_ = ring_.create(path, capacity);
+    return open_;
+}
+
+void LiveStatusPublisher::publish(const FrameStatus& status) {
+    if (!open_) {
+        return;
+    }
+    to_status_record(status, &record_);
+    ring_.write(&record_);
+}
+
+// latencies in us, log-linear buckets: exact below 2 * LATENCY_SUB_BUCKETS, then LATENCY_SUB_BUCKETS
+// per power of two (about 3% wide), so a tail of any length takes the same few kB
+static const int LATENCY_SUB_BUCKETS = 32;
+static const int LATENCY_MAX_BITS = 40;
+
+class LatencyHistogram {
+  private:
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+
+    static int bucket(const uint64_t& us) {
+        if (us < 2 * LATENCY_SUB_BUCKETS) {
+            return static_cast<int>(us);
+        }
+        int bits = 0;
+        while (bits < LATENCY_MAX_BITS && (us >> (bits + 1)) != 0) {
+            bits++;
+        }
+        const int shift = bits - 5;
+        return LATENCY_SUB_BUCKETS * (shift + 1) + static_cast<int>(std::min<uint64_t>(us >> shift, 2 * LATENCY_SUB_BUCKETS - 1)) - LATENCY_SUB_BUCKETS;
+    }
+
+  public:
+    LatencyHistogram() : counts_(LATENCY_SUB_BUCKETS * (LATENCY_MAX_BITS - 3), 0), total_(0) {}
+
+    void add(const double& us) {
+        counts_[bucket(static_cast<uint64_t>(std::max(0.0, us)))]++;
+        total_++;
+    }
+    uint64_t total() const {
+        return total_;
+    }
+    // middle of the bucket holding the q-th latency
+    double percentile(const double& q) const {
+        const uint64_t rank = static_cast<uint64_t>(q * total_);
+        uint64_t seen = 0;
+        for (size_t b = 0; b < counts_.size(); b++) {
+            seen += counts_[b];
+            if (seen > rank) {
+                if (b < 2 * LATENCY_SUB_BUCKETS) {
+                    return b;
+                }
+                const int shift = static_cast<int>(b) / LATENCY_SUB_BUCKETS - 1;
+                const uint64_t low = static_cast<uint64_t>(b % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS) << shift;
+                return low + (static_cast<uint64_t>(1) << shift) / 2.0;
+            }
+        }
+        return 0;
+    }
+};
+
+int run_ring_tail(int argc, char** argv) {
+    std::string path = DEFAULT_STATUS_RING;
+    int first_option = 2;
+    if (argc > 2 && argv[2][0] != '-') {
+        path = argv[2];
+        first_option = 3;
+    }
+    long count = -1;
+    int timeout_s = 10;
+    bool quiet = false;
+    for (int i = first_option; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--count" && i + 1 < argc) {
+            count = std::atol(argv[++i]);
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            timeout_s = std::atoi(argv[++i]);
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else {
+            std::cerr << "Unknown ring tail option " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    StatusRingReader reader;
+    if (!reader.open(path)) {
+        std::cerr << "Cannot open status ring " << path << ", is a producer running with --status-ring?" << std::endl;
+        return -1;
+    }
+    TextWriter writer;
+    if (!quiet && !writer.open("-", TextWriter::NDJSON)) {
+        return -1;
+    }
+    StatusRecord record;
+    FrameStatus status;
+    LatencyHistogram latency_us;
+    for (long n = 0; count < 0 || n < count; n++) {
+        if (!reader.wait(&record, timeout_s * 1000)) {
+            std::cerr << "No record for " << timeout_s << " s" << std::endl;
+            break;
+        }
+        latency_us.add((ring_clock_ns() - record.produced_ns) / 1000.0);
+        if (!quiet) {
+            to_frame_status(record, &status);
+            writer.write(status);
+            writer.flush();
+        }
+    }
+    writer.close();
+    if (latency_us.total() > 0) {
+        std::cerr << latency_us.total() << " records, " << reader.missed() << " missed, producer to consumer latency p50 "
+                  << latency_us.percentile(0.5) << " us, p99 " << latency_us.percentile(0.99) << " us" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef LIVE_STATUS_H
+#define LIVE_STATUS_H
+
+#include "game_video.h"
+#include "status_ring.h"
+
+// FrameStatus over the shared-memory status ring, see status_ring.h
+
+#define DEFAULT_STATUS_RING "/dev/shm/game_video_status"
+
+void to_status_record(const FrameStatus&, StatusRecord*);
+void to_frame_status(const StatusRecord&, FrameStatus*);
+
+// publishes each analyzed frame, a no-op until opened
+class LiveStatusPublisher {
+  private:
+    StatusRingWriter ring_;
+    StatusRecord record_;
+    bool open_;
+
+  public:
+    LiveStatusPublisher();
+    bool open(const std::string& path, const uint32_t& capacity = 1024);
+    void publish(const FrameStatus&);
+};
+
+// usage: game_video --ring-tail [ring] [--count N] [--timeout 10] [--quiet]
+// prints records as NDJSON and the producer to consumer latency at the end
+int run_ring_tail(int argc, char** argv);
+
+#endif
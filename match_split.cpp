@@ -0,0 +1,335 @@
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <sstream>
+#include <sys/stat.h>
+#include "match_split.h"
+#include "result_file.h"
+#include "thread_policy.h"
+#include "window_query.h"
+
+static const char* BOUNDARY_CAUSE_NAMES[] = {"start", "hud", "money reset", "level reset"};
+
+const char* boundary_cause_name(const int& cause) {
+    return BOUNDARY_CAUSE_NAMES[cause];
+}
+
+bool probe_frame(const FrameReader::LoadFunction& load, const size_t& index, const int& ts, const NumberSamples& samples, MatchProbe* probe) {
+    cv::Mat frame;
+    if (!load(index, &frame) || frame.empty()) {
+        return false;
+    }
+    GameVideoAnalyzer game_video_analyzer;
+    game_video_analyzer.set_display(false);
+    game_video_analyzer.adjust_size(&frame);
+    FrameStatus status;
+    game_video_analyzer.process_frame(&frame, ts, samples, &status);
+    probe->ts = ts;
+    probe->money = status.money;
+    probe->hud = status.money > 0;
+    probe->max_level = 0;
+    for (size_t i = 0; i < status.hero_list.size(); i++) {
+        probe->max_level = std::max(probe->max_level, status.hero_list[i].level);
+    }
+    return true;
+}
+
+// a frame at the start of a match: HUD, starting money and no hero above level 2
+static inline bool looks_like_start(const MatchProbe& probe, const MatchSplitOptions& options) {
+    return probe.hud && std::abs(probe.money - options.start_money) <= options.start_money_tol && probe.max_level <= 2;
+}
+
+// how a new match began between a and b, BOUNDARY_START when it did not
+static BoundaryCause reset_between(const MatchProbe& a, const MatchProbe& b, const MatchSplitOptions& options) {
+    if (!b.hud) {
+        return BOUNDARY_START;
+    }
+    if (a.max_level >= options.reset_level && b.max_level >= 1 && b.max_level <= 2) {
+        return BOUNDARY_LEVEL;
+    }
+    if (a.money > options.start_money + options.start_money_tol && looks_like_start(b, options)) {
+        return BOUNDARY_MONEY;
+    }
+    return BOUNDARY_START;
+}
+
+class ProbeBody : public cv::ParallelLoopBody {
+  private:
+    const ProbeFunction* probe_;
+    const std::vector<size_t>* indices_;
+    std::vector<MatchProbe>* probes_;
+    std::vector<char>* ok_;
+
+  public:
+    ProbeBody(const ProbeFunction* probe, const std::vector<size_t>* indices, std::vector<MatchProbe>* probes, std::vector<char>* ok)
+        : probe_(probe), indices_(indices), probes_(probes), ok_(ok) {}
+
+    void operator()(const cv::Range& range) const {
+        for (int i = range.start; i < range.end; i++) {
+            (*ok_)[i] = (*probe_)((*indices_)[i], &(*probes_)[i]);
+        }
+    }
+};
+
+// first frame in (lo, hi] whose probe satisfies the condition, which holds at hi and not at lo
+template <class Condition>
+static bool bisect_boundary(const ProbeFunction& probe_at, size_t lo, size_t hi, const Condition& condition, size_t* boundary, size_t* probes) {
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        MatchProbe probe;
+        if (!probe_at(mid, &probe)) {
+            return false;
+        }
+        (*probes)++;
+        if (condition(probe)) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    *boundary = hi;
+    return true;
+}
+
+bool find_match_segments(const FrameReader::LoadFunction& load, const std::vector<int>& timestamps, const NumberSamples& samples,
+                         const MatchSplitOptions& options, std::vector<MatchSegment>* segments, size_t* probes) {
+    ProbeFunction probe = [&load, &timestamps, &samples](const size_t& index, MatchProbe* result) {
+        return probe_frame(load, index, timestamps[index], samples, result);
+    };
+    return find_match_segments(probe, timestamps, options, segments, probes);
+}
+
+bool find_match_segments(const ProbeFunction& probe, const std::vector<int>& timestamps, const MatchSplitOptions& options,
+                         std::vector<MatchSegment>* segments, size_t* probes) {
+    segments->clear();
+    size_t probe_count = 0;
+    if (probes) {
+        *probes = 0;
+    }
+    if (timestamps.empty()) {
+        return true;
+    }
+
+    // one sample every sample_ms, and the last frame
+    std::vector<size_t> sampled;
+    int next_ts = INT_MIN;
+    for (size_t i = 0; i < timestamps.size(); i++) {
+        if (timestamps[i] >= next_ts) {
+            sampled.push_back(i);
+            next_ts = timestamps[i] + options.sample_ms;
+        }
+    }
+    if (sampled.back() != timestamps.size() - 1) {
+        sampled.push_back(timestamps.size() - 1);
+    }
+    std::vector<MatchProbe> sample_probes(sampled.size());
+    std::vector<char> ok(sampled.size(), 0);
+    cv::parallel_for_(cv::Range(0, static_cast<int>(sampled.size())), ProbeBody(&probe, &sampled, &sample_probes, &ok));
+    for (size_t k = 0; k < ok.size(); k++) {
+        if (!ok[k]) {
+            return false;
+        }
+    }
+    probe_count += sampled.size();
+
+    // samples without HUD between two with it are one misread money reading unless there are
+    // hud_gap_samples of them in a row, they are left out; gaps at either end of the file are kept
+    std::vector<size_t> kept;
+    for (size_t k = 0; k < sampled.size();) {
+        size_t end = k + 1;
+        if (!sample_probes[k].hud) {
+            while (end < sampled.size() && !sample_probes[end].hud) {
+                end++;
+            }
+            if (k > 0 && end < sampled.size() && end - k < static_cast<size_t>(std::max(1, options.hud_gap_samples))) {
+                k = end;
+                continue;
+            }
+        }
+        for (; k < end; k++) {
+            kept.push_back(k);
+        }
+    }
+
+    std::vector<MatchSegment> found;
+    bool open = false;
+    MatchSegment segment = {0, 0, 0, 0, BOUNDARY_START};
+    if (sample_probes[0].hud) {
+        open = true;
+    }
+    for (size_t j = 1; j < kept.size(); j++) {
+        const MatchProbe& a = sample_probes[kept[j - 1]];
+        const MatchProbe& b = sample_probes[kept[j]];
+        const size_t lo = sampled[kept[j - 1]], hi = sampled[kept[j]];
+        size_t boundary;
+        if (a.hud && !b.hud) {
+            if (!bisect_boundary(probe, lo, hi, [](const MatchProbe& probe) { return !probe.hud; }, &boundary, &probe_count)) {
+                return false;
+            }
+            segment.last = boundary;
+            found.push_back(segment);
+            open = false;
+        } else if (!a.hud && b.hud) {
+            if (!bisect_boundary(probe, lo, hi, [](const MatchProbe& probe) { return probe.hud; }, &boundary, &probe_count)) {
+                return false;
+            }
+            MatchSegment next = {boundary, 0, 0, 0, BOUNDARY_HUD};
+            segment = next;
+            open = true;
+        } else if (a.hud && b.hud) {
+            BoundaryCause cause = reset_between(a, b, options);
+            if (cause == BOUNDARY_START) {
+                continue;
+            }
+            if (!bisect_boundary(probe, lo, hi, [&a, &options, cause](const MatchProbe& probe) { return reset_between(a, probe, options) == cause; },
+                                 &boundary, &probe_count)) {
+                return false;
+            }
+            segment.last = boundary;
+            found.push_back(segment);
+            MatchSegment next = {boundary, 0, 0, 0, cause};
+            segment = next;
+        }
+    }
+    if (open) {
+        segment.last = timestamps.size();
+        found.push_back(segment);
+    }
+
+    for (size_t i = 0; i < found.size(); i++) {
+        MatchSegment& match = found[i];
+        match.start_ts = timestamps[match.first];
+        match.end_ts = timestamps[match.last - 1];
+        if (match.last > match.first && match.end_ts - match.start_ts >= options.min_segment_ms) {
+            segments->push_back(match);
+        }
+    }
+    if (probes) {
+        *probes = probe_count;
+    }
+    return true;
+}
+
+// analyzes whole segments on one shared analyzer, each with its own stream state and result file
+class SegmentBody : public cv::ParallelLoopBody {
+  private:
+    const GameVideoAnalyzer* analyzer_;
+    const FrameReader::LoadFunction* load_;
+    const std::vector<int>* timestamps_;
+    const NumberSamples* samples_;
+    const std::vector<MatchSegment>* segments_;
+    const std::string* output_folder_;
+    std::vector<char>* ok_;
+
+  public:
+    SegmentBody(const GameVideoAnalyzer* analyzer, const FrameReader::LoadFunction* load, const std::vector<int>* timestamps, const NumberSamples* samples,
+                const std::vector<MatchSegment>* segments, const std::string* output_folder, std::vector<char>* ok)
+        : analyzer_(analyzer), load_(load), timestamps_(timestamps), samples_(samples), segments_(segments), output_folder_(output_folder), ok_(ok) {}
+
+    void operator()(const cv::Range& range) const {
+        for (int k = range.start; k < range.end; k++) {
+            const MatchSegment& segment = (*segments_)[k];
+            StreamState stream;
+            ResultWriter writer;
+            std::ostringstream path;
+            path << *output_folder_ << "/match_" << k << ".gvr";
+            bool ok = writer.open(path.str());
+            cv::Mat frame;
+            for (size_t i = segment.first; i < segment.last && ok; i++) {
+                if (!(*load_)(i, &frame) || frame.empty()) {
+                    ok = false;
+                    break;
+                }
+                analyzer_->adjust_size(&frame);
+                FrameStatus status;
+                analyzer_->process_frame(&frame, (*timestamps_)[i], *samples_, &stream, &status);
+                ok = writer.write(status);
+            }
+            (*ok_)[k] = writer.close() && ok;
+        }
+    }
+};
+
+int run_split_matches(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "usage: game_video --split-matches <frames folder> <output folder> [--sample 5s] [--start-money 300] "
+                  << "[--min-match 60s] [--hud-gap 2] [--threads N] [--samples ../samples]" << std::endl;
+        return -1;
+    }
+    MatchSplitOptions options = DEFAULT_MATCH_SPLIT_OPTIONS;
+    std::string samples_folder = "../samples";
+    int threads = -1;
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--sample" && i + 1 < argc) {
+            options.sample_ms = std::max(1, parse_duration_ms(argv[++i]));
+        } else if (arg == "--start-money" && i + 1 < argc) {
+            options.start_money = std::atoi(argv[++i]);
+        } else if (arg == "--min-match" && i + 1 < argc) {
+            options.min_segment_ms = parse_duration_ms(argv[++i]);
+        } else if (arg == "--hud-gap" && i + 1 < argc) {
+            options.hud_gap_samples = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg == "--samples" && i + 1 < argc) {
+            samples_folder = argv[++i];
+        } else {
+            std::cerr << "Unknown split option " << arg << std::endl;
+            return -1;
+        }
+    }
+    // probes and segments take the pool, each frame is analyzed serially
+    use_threads(PARALLEL_ACROSS_TASKS, threads);
+    std::string output_folder = argv[3];
+    if (mkdir(output_folder.c_str(), 0775) != 0 && errno != EEXIST) {
+        std::cerr << "Cannot create " << output_folder << std::endl;
+        return -1;
+    }
+
+    NumberSamples samples;
+    if (!load_number_samples(samples_folder, &samples)) {
+        return -1;
+    }
+    std::vector<cv::String> filenames;
+    cv::glob(argv[2], filenames);
+    std::vector<int> timestamps(filenames.size());
+    for (size_t i = 0; i < filenames.size(); i++) {
+        timestamps[i] = parse_frame_timestamp(filenames[i]);
+    }
+    FrameReader::LoadFunction load = [&filenames](const size_t& index, cv::Mat* frame) {
+        *frame = cv::imread(filenames[index]);
+        return frame->data != NULL;
+    };
+
+    int64 start = cv::getTickCount();
+    std::vector<MatchSegment> segments;
+    size_t probes = 0;
+    if (!find_match_segments(load, timestamps, samples, options, &segments, &probes)) {
+        std::cerr << "Fail reading frames of " << argv[2] << std::endl;
+        return -1;
+    }
+    double split_s = (cv::getTickCount() - start) / cv::getTickFrequency();
+    std::cout << segments.size() << " matches in " << filenames.size() << " frames, found with " << probes
+              << " probed frames in " << split_s << " s" << std::endl;
+    for (size_t k = 0; k < segments.size(); k++) {
+        std::cout << "match_" << k << ": frames " << segments[k].first << "-" << segments[k].last - 1 << ", "
+                  << segments[k].start_ts << "-" << segments[k].end_ts << " ms, starts at " << boundary_cause_name(segments[k].cause) << std::endl;
+    }
+
+    start = cv::getTickCount();
+    std::vector<char> ok(segments.size(), 0);
+    GameVideoAnalyzer game_video_analyzer;
+    game_video_analyzer.set_display(false);
+    cv::parallel_for_(cv::Range(0, static_cast<int>(segments.size())),
+                      SegmentBody(&game_video_analyzer, &load, &timestamps, &samples, &segments, &output_folder, &ok));
+    int failed = 0;
+    for (size_t k = 0; k < ok.size(); k++) {
+        if (!ok[k]) {
+            std::cerr << "Fail analyzing match_" << k << std::endl;
+            failed++;
+        }
+    }
+    std::cout << "Analyzed " << segments.size() - failed << " matches in " << (cv::getTickCount() - start) / cv::getTickFrequency()
+              << " s, results in " << output_folder << std::endl;
+    return failed == 0 ? 0 : -1;
+}
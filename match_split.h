@@ -0,0 +1,72 @@
+#ifndef MATCH_SPLIT_H
+#define MATCH_SPLIT_H
+
+#include "frame_reader.h"
+
+// Splits a recording of several matches (e.g. a tournament VOD with casting in between) into
+// independent match segments, then analyzes the segments in parallel on one analyzer, each with a
+// fresh StreamState so hero tracks never cross a match boundary.
+// Boundaries are found on sparse samples: every sample_ms a frame is probed for HUD presence
+// (money readable), money and the highest hero level. Between two samples a boundary is
+// - HUD appearing or disappearing (casting, lobby or replay segments have no HUD) for at least
+//   hud_gap_samples samples in a row; a shorter gap inside a match is one misread money reading,
+// - money dropping back to the starting money with no hero above level 2 (spending alone also
+//   drops money, the levels tell the two apart),
+// - the highest level dropping from reset_level or more back to level 1 or 2;
+// then the frame where it happens is found by bisecting the frames between the two samples.
+
+struct MatchProbe {
+    int ts;
+    bool hud;
+    int money;
+    int max_level;    // 0 when no hero is seen
+};
+
+struct MatchSplitOptions {
+    int sample_ms;          // probe interval
+    int start_money;        // money at the start of a match
+    int start_money_tol;    // readings within start_money +- start_money_tol count as starting money
+    int reset_level;        // highest level a match must have reached before a level reset counts
+    int min_segment_ms;     // shorter HUD segments (e.g. replays) are dropped
+    int hud_gap_samples;    // consecutive samples without HUD that end a match, fewer are misreads
+};
+
+const MatchSplitOptions DEFAULT_MATCH_SPLIT_OPTIONS = {5000, 300, 50, 4, 60000, 2};
+
+enum BoundaryCause {
+    BOUNDARY_START = 0,    // first frame of the file
+    BOUNDARY_HUD,          // HUD appeared
+    BOUNDARY_MONEY,        // money reset
+    BOUNDARY_LEVEL         // level reset
+};
+
+const char* boundary_cause_name(const int&);
+
+// frames [first, last) of one match
+struct MatchSegment {
+    size_t first;
+    size_t last;
+    int start_ts;
+    int end_ts;
+    BoundaryCause cause;
+};
+
+// one analysis of a frame with a throwaway analyzer, so probes are independent and run in parallel
+bool probe_frame(const FrameReader::LoadFunction&, const size_t& index, const int& ts, const NumberSamples&, MatchProbe*);
+
+// probes the frame at index, called in parallel
+typedef std::function<bool(const size_t& index, MatchProbe*)> ProbeFunction;
+
+// segments of the frames with the given timestamps, probes decode probes.size() frames
+bool find_match_segments(const FrameReader::LoadFunction&, const std::vector<int>& timestamps, const NumberSamples&,
+                         const MatchSplitOptions&, std::vector<MatchSegment>*, size_t* probes = NULL);
+// the same on frames probed by probe, probes counts its calls
+bool find_match_segments(const ProbeFunction& probe, const std::vector<int>& timestamps, const MatchSplitOptions&,
+                         std::vector<MatchSegment>*, size_t* probes = NULL);
+
+// usage: game_video --split-matches <frames folder> <output folder> [--sample 5s] [--start-money 300]
+//        [--min-match 60s] [--hud-gap 2] [--threads N] [--samples ../samples]
+// writes match_<k>.gvr per segment
+int run_split_matches(int argc, char** argv);
+
+#endif
@@ -0,0 +1,165 @@
+#include <cmath>
+#include "match_summary.h"
+#include "result_file.h"
+
+// frames further apart (paused recording, dropped frames) don't count as joystick time
+static const int MAX_FRAME_GAP_MS = 1000;
+
+static const char* DIRECTION_NAMES[JOYSTICK_DIRECTIONS] = {"E", "NE", "N", "NW", "W", "SW", "S", "SE"};
+
+const char* joystick_direction_name(const int& direction) {
+    return direction >= 0 && direction < JOYSTICK_DIRECTIONS ? DIRECTION_NAMES[direction] : "unknown";
+}
+
+// -1 while the joystick is released, estimate_joystick_angle reports 666 then
+static int joystick_direction(const double& angle) {
+    if (!(angle >= -180 && angle <= 180)) {
+        return -1;
+    }
+    int direction = static_cast<int>(std::floor((angle + 180.0 / JOYSTICK_DIRECTIONS) / (360.0 / JOYSTICK_DIRECTIONS)));
+    return (direction + JOYSTICK_DIRECTIONS) % JOYSTICK_DIRECTIONS;
+}
+
+MatchAggregator::MatchAggregator() {
+    reset();
+}
+
+void MatchAggregator::reset() {
+    frames_ = 0;
+    first_ts_ = 0;
+    last_ts_ = 0;
+    money_ = -1;
+    money_candidate_ = -1;
+    gold_earned_ = 0;
+    for (int i = 0; i < NUM_COOLDOWNS; i++) {
+        cooldown_[i] = 0;
+        cooldown_candidate_[i] = 0;
+        casts_[i] = 0;
+    }
+    joystick_angle_ = 666.0;
+    for (int i = 0; i < JOYSTICK_DIRECTIONS; i++) {
+        joystick_ms_[i] = 0;
+    }
+    hero_states_.clear();
+    heroes_.clear();
+}
+
+void MatchAggregator::add(const FrameStatus& status) {
+    if (frames_ == 0) {
+        first_ts_ = status.ts;
+    } else {
+        int direction = joystick_direction(joystick_angle_);
+        int dt = status.ts - last_ts_;
+        if (direction >= 0 && dt > 0 && dt <= MAX_FRAME_GAP_MS) {
+            joystick_ms_[direction] += dt;
+        }
+    }
+    frames_++;
+    last_ts_ = status.ts;
+    joystick_angle_ = status.joystick_angle;
+
+    // money only goes down by spending, increases are earned gold
+    if (status.money == money_candidate_ && status.money != money_) {
+        if (money_ >= 0 && status.money > money_) {
+            gold_earned_ += status.money - money_;
+        }
+        money_ = status.money;
+    }
+    money_candidate_ = status.money;
+
+    const int cooldowns[NUM_COOLDOWNS] = {status.spell1_cd, status.spell2_cd, status.spell3_cd,
+                                          status.skill1_cd, status.skill2_cd, status.skill3_cd, status.skill4_cd};
+    for (int i = 0; i < NUM_COOLDOWNS; i++) {
+        if (cooldowns[i] == cooldown_candidate_[i] && cooldowns[i] != cooldown_[i]) {
+            // cooldowns count down, so a rise is a cast
+            if (cooldowns[i] > cooldown_[i]) {
+                casts_[i]++;
+            }
+            cooldown_[i] = cooldowns[i];
+        }
+        cooldown_candidate_[i] = cooldowns[i];
+    }
+
+    for (size_t i = 0; i < status.hero_list.size(); i++) {
+        const HeroStatus& hero = status.hero_list[i];
+        std::map<int, HeroTimeline>::iterator timeline = heroes_.find(hero.hero_id);
+        if (timeline == heroes_.end()) {
+            HeroTimeline first = {status.ts, status.ts, std::vector<LevelChange>()};
+            timeline = heroes_.insert(std::make_pair(hero.hero_id, first)).first;
+            HeroState state = {0, -1};
+            hero_states_[hero.hero_id] = state;
+        }
+        timeline->second.last_seen = status.ts;
+        HeroState& state = hero_states_[hero.hero_id];
+        if (hero.level == state.candidate && hero.level > state.level) {
+            LevelChange change = {status.ts, hero.level};
+            timeline->second.levels.push_back(change);
+            state.level = hero.level;
+        }
+        state.candidate = hero.level;
+    }
+}
+
+void MatchAggregator::summarize(MatchSummary* summary) const {
+    summary->frames = frames_;
+    summary->duration_ms = last_ts_ - first_ts_;
+    summary->final_money = money_;
+    summary->gold_earned = gold_earned_;
+    summary->gold_per_minute = summary->duration_ms > 0 ? gold_earned_ * 60000.0 / summary->duration_ms : 0;
+    summary->joystick_active_ms = 0;
+    for (int i = 0; i < NUM_COOLDOWNS; i++) {
+        summary->casts[i] = casts_[i];
+    }
+    for (int i = 0; i < JOYSTICK_DIRECTIONS; i++) {
+        summary->joystick_ms[i] = joystick_ms_[i];
+        summary->joystick_active_ms += joystick_ms_[i];
+    }
+    summary->heroes = heroes_;
+}
+
+void print_match_summary(const MatchSummary& summary) {
+    const char* cooldown_names[NUM_COOLDOWNS] = {"Spell 1", "Spell 2", "Spell 3", "Skill 1", "Skill 2", "Skill 3", "Skill 4"};
+    std::cout << "Frames: " << summary.frames << ", duration " << summary.duration_ms / 1000.0 << " s" << std::endl;
+    std::cout << "Money: " << summary.final_money << ", earned " << summary.gold_earned << ", "
+              << summary.gold_per_minute << " per minute" << std::endl;
+    for (int i = 0; i < NUM_COOLDOWNS; i++) {
+        std::cout << cooldown_names[i] << " casts: " << summary.casts[i] << std::endl;
+    }
+    std::cout << "Joystick active: " << summary.joystick_active_ms / 1000.0 << " s";
+    for (int i = 0; i < JOYSTICK_DIRECTIONS; i++) {
+        std::cout << (i == 0 ? " (" : ", ") << DIRECTION_NAMES[i] << " " << summary.joystick_ms[i] / 1000.0;
+    }
+    std::cout << ")" << std::endl;
+    for (std::map<int, HeroTimeline>::const_iterator it = summary.heroes.begin(); it != summary.heroes.end(); ++it) {
+        std::cout << "Hero " << it->first << ": " << it->second.first_seen << "-" << it->second.last_seen << " ms, levels";
+        for (size_t i = 0; i < it->second.levels.size(); i++) {
+            std::cout << " " << it->second.levels[i].level << "@" << it->second.levels[i].ts;
+        }
+        std::cout << std::endl;
+    }
+}
+
+int run_summary(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: game_video --summary <results.gvr>" << std::endl;
+        return -1;
+    }
+    ResultReader reader;
+    if (!reader.open(argv[2])) {
+        std::cerr << "Cannot read result file " << argv[2] << std::endl;
+        return -1;
+    }
+    MatchAggregator aggregator;
+    FrameStatus status;
+    while (reader.read(&status)) {
+        aggregator.add(status);
+    }
+    if (reader.error()) {
+        std::cerr << "Truncated or corrupted result file " << argv[2] << std::endl;
+        return -1;
+    }
+    MatchSummary summary;
+    aggregator.summarize(&summary);
+    print_match_summary(summary);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#ifndef MATCH_SUMMARY_H
+#define MATCH_SUMMARY_H
+
+#include <map>
+#include "game_video.h"
+
+// Per-match metrics aggregated incrementally from the FrameStatus stream, so the summary is
+// ready when the stream ends without another pass over status_list_ or a result file.
+// State is constant per metric: the last readings of money, each cooldown and the joystick,
+// and per hero its current level and level-up timestamps (levels only go up, so bounded).
+// OCR readings are debounced, a value has to be read in two consecutive frames to count.
+
+#define JOYSTICK_DIRECTIONS 8
+
+// direction buckets of 45 degrees centered on E, NE, N, NW, W, SW, S, SE
+const char* joystick_direction_name(const int&);
+
+struct LevelChange {
+    int ts;
+    int level;
+};
+
+struct HeroTimeline {
+    int first_seen;
+    int last_seen;
+    std::vector<LevelChange> levels;
+};
+
+struct MatchSummary {
+    size_t frames;
+    int duration_ms;
+    int final_money;
+    int gold_earned;    // sum of money increases, spending does not subtract
+    double gold_per_minute;
+    int casts[NUM_COOLDOWNS];    // spell1-3, skill1-4
+    int joystick_active_ms;
+    int joystick_ms[JOYSTICK_DIRECTIONS];
+    std::map<int, HeroTimeline> heroes;    // by hero id
+};
+
+class MatchAggregator {
+  private:
+    struct HeroState {
+        int level;        // level confirmed last
+        int candidate;    // level read in the previous frame
+    };
+
+    size_t frames_;
+    int first_ts_;
+    int last_ts_;
+    int money_;             // confirmed money, -1 before the first
+    int money_candidate_;
+    int gold_earned_;
+    int cooldown_[NUM_COOLDOWNS];    // confirmed seconds left, a rise means the skill was cast
+    int cooldown_candidate_[NUM_COOLDOWNS];
+    int casts_[NUM_COOLDOWNS];
+    double joystick_angle_;    // of the previous frame, its direction holds until this one
+    int joystick_ms_[JOYSTICK_DIRECTIONS];
+    std::map<int, HeroState> hero_states_;
+    std::map<int, HeroTimeline> heroes_;
+
+  public:
+    MatchAggregator();
+    void reset();
+    void add(const FrameStatus&);
+    void summarize(MatchSummary*) const;
+};
+
+void print_match_summary(const MatchSummary&);
+
+// usage: game_video --summary <results.gvr>
+int run_summary(int argc, char** argv);
+
+#endif
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include "result_export.h"
+#include "arrow_writer.h"
+#include "column_store.h"
+#include "result_file.h"
+#include "text_writer.h"
+
+template <typename Writer>
+static bool export_frames(ResultReader* reader, Writer* writer, size_t* frames) {
+    FrameStatus status;
+    bool ok = true;
+    *frames = 0;
+    while (ok && reader->read(&status)) {
+        ok = writer->write(status);
+        (*frames)++;
+    }
+    if (ok && reader->error()) {
+        std::cerr << "Truncated or corrupted result file after " << *frames << " frames" << std::endl;
+        ok = false;
+    }
+    return writer->close() && ok;
+}
+
+int run_export(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "usage: game_video --export <input.gvr> <output> [--format arrow|arrow-stream|ndjson|csv|csv-heroes|gvc] "
+                  << "[--batch 65536] [--fields ts,...]" << std::endl;
+        return -1;
+    }
+    std::string output = argv[3];
+    std::string format = "arrow";
+    size_t batch_size = 0;
+    unsigned fields = ALL_TEXT_FIELDS;
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batch_size = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--fields" && i + 1 < argc) {
+            if (!parse_text_fields(argv[++i], &fields)) {
+                return -1;
+            }
+        } else {
+            std::cerr << "Unknown export option " << arg << std::endl;
+            return -1;
+        }
+    }
+
+    ResultReader reader;
+    if (!reader.open(argv[2])) {
+        std::cerr << "Cannot read result file " << argv[2] << std::endl;
+        return -1;
+    }
+    bool opened = false, ok = false;
+    size_t frames = 0;
+    if (format == "arrow" || format == "arrow-stream") {
+        ArrowWriter writer;
+        opened = writer.open(output, format == "arrow" ? ArrowWriter::ARROW_FILE : ArrowWriter::ARROW_STREAM, batch_size ? batch_size : 65536);
+        ok = opened && export_frames(&reader, &writer, &frames);
+    } else if (format == "gvc") {
+        ColumnWriter writer;
+        opened = writer.open(output, batch_size ? batch_size : 4096);
+        ok = opened && export_frames(&reader, &writer, &frames);
+    } else if (format == "ndjson" || format == "csv" || format == "csv-heroes") {
+        TextWriter writer;
+        TextWriter::Format text_format = format == "ndjson" ? TextWriter::NDJSON : format == "csv" ? TextWriter::CSV : TextWriter::HERO_CSV;
+        opened = writer.open(output, text_format, fields);
+        ok = opened && export_frames(&reader, &writer, &frames);
+    } else {
+        std::cerr << "Unknown export format " << format << std::endl;
+        return -1;
+    }
+    if (!opened) {
+        std::cerr << "Cannot write " << output << std::endl;
+        return -1;
+    }
+    if (!ok) {
+        std::cerr << "Writing " << output << " failed" << std::endl;
+        return -1;
+    }
+    // keep stdout clean when the export goes there
+    (output == "-" ? std::cerr : std::cout) << "Exported " << frames << " frames to " << output << std::endl;
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef RESULT_EXPORT_H
+#define RESULT_EXPORT_H
+
+// Conversion of .gvr result files for consumers outside this program.
+// formats: arrow (Arrow IPC file), arrow-stream, ndjson, csv, csv-heroes (one row per hero),
+//          gvc (compressed column store queried by --select).
+// --batch sets the frames per Arrow record batch (default 65536) or per gvc chunk (default 4096).
+// --fields selects the columns of ndjson and csv, e.g. --fields ts,money,heroes. Output "-" is stdout.
+
+// usage: game_video --export <input.gvr> <output> [--format arrow] [--batch 65536] [--fields ts,...]
+int run_export(int argc, char** argv);
+
+#endif
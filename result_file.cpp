@@ -0,0 +1,231 @@
+#include <cstring>
+#include <stdint.h>
+#include "result_file.h"
+
+static const char RESULT_MAGIC[4] = {'G', 'V', 'R', '1'};
+static const char INDEX_MAGIC[4] = {'G', 'V', 'R', 'I'};
+static const size_t INDEX_ENTRY_SIZE = 4 + 8;
+static const size_t INDEX_FOOTER_SIZE = 8 + 4 + 4;
+static const size_t RECORD_FIXED_SIZE = 4 + 8 + 4 * 8 + 4;
+static const size_t HERO_SIZE = 4 * 4;
+static const uint32_t MAX_HEROES_PER_RECORD = 4096;    // guards against corrupted files
+
+template <typename T>
+static inline void put(std::vector<char>* buffer, const T& value) {
+    const char* p = reinterpret_cast<const char*>(&value);
+    buffer->insert(buffer->end(), p, p + sizeof(T));
+}
+
+template <typename T>
+static inline T get(const char** p) {
+    T value;
+    memcpy(&value, *p, sizeof(T));
+    *p += sizeof(T);
+    return value;
+}
+
+ResultWriter::ResultWriter() : file_(NULL), offset_(0), records_(0), index_interval_(0) {}
+
+ResultWriter::~ResultWriter() {
+    close();
+}
+
+bool ResultWriter::open(const std::string& path, const size_t& index_interval) {
+    close();
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    offset_ = sizeof(RESULT_MAGIC);
+    records_ = 0;
+    index_interval_ = index_interval;
+    index_.clear();
+    return fwrite(RESULT_MAGIC, 1, sizeof(RESULT_MAGIC), file_) == sizeof(RESULT_MAGIC);
+}
+
+bool ResultWriter::write(const FrameStatus& status) {
+    buffer_.clear();
+    put<int32_t>(&buffer_, status.ts);
+    put<double>(&buffer_, status.joystick_angle);
+    put<int32_t>(&buffer_, status.spell1_cd);
+    put<int32_t>(&buffer_, status.spell2_cd);
+    put<int32_t>(&buffer_, status.spell3_cd);
+    put<int32_t>(&buffer_, status.skill1_cd);
+    put<int32_t>(&buffer_, status.skill2_cd);
+    put<int32_t>(&buffer_, status.skill3_cd);
+    put<int32_t>(&buffer_, status.skill4_cd);
+    put<int32_t>(&buffer_, status.money);
+    put<uint32_t>(&buffer_, static_cast<uint32_t>(status.hero_list.size()));
+    for (size_t i = 0; i < status.hero_list.size(); i++) {
+        const HeroStatus& hero = status.hero_list[i];
+        put<int32_t>(&buffer_, hero.hero_id);
+        put<int32_t>(&buffer_, hero.position.x);
+        put<int32_t>(&buffer_, hero.position.y);
+        put<int32_t>(&buffer_, hero.level);
+    }
+    if (!file_ || fwrite(&buffer_[0], 1, buffer_.size(), file_) != buffer_.size()) {
+        return false;
+    }
+    if (index_interval_ > 0 && records_ % index_interval_ == 0) {
+        ResultIndexEntry entry = {status.ts, offset_};
+        index_.push_back(entry);
+    }
+    offset_ += buffer_.size();
+    records_++;
+    return true;
+}
+
+bool ResultWriter::close() {
+    if (!file_) {
+        return true;
+    }
+    if (index_interval_ > 0) {
+        buffer_.clear();
+        for (size_t i = 0; i < index_.size(); i++) {
+            put<int32_t>(&buffer_, index_[i].ts);
+            put<uint64_t>(&buffer_, index_[i].offset);
+        }
+        put<uint64_t>(&buffer_, offset_);
+        put<uint32_t>(&buffer_, static_cast<uint32_t>(index_.size()));
+        buffer_.insert(buffer_.end(), INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC));
+        fwrite(&buffer_[0], 1, buffer_.size(), file_);
+    }
+    bool ok = fflush(file_) == 0 && !ferror(file_);
+    ok = fclose(file_) == 0 && ok;
+    file_ = NULL;
+    return ok;
+}
+
+ResultReader::ResultReader() : file_(NULL), offset_(0), end_(0), error_(false) {}
+
+ResultReader::~ResultReader() {
+    close();
+}
+
+bool ResultReader::open(const std::string& path) {
+    close();
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+        return false;
+    }
+    char magic[4];
+    if (fread(magic, 1, sizeof(magic), file_) != sizeof(magic) || memcmp(magic, RESULT_MAGIC, sizeof(magic)) != 0) {
+        close();
+        return false;
+    }
+    if (!read_index()) {
+        close();
+        return false;
+    }
+    error_ = false;
+    offset_ = sizeof(RESULT_MAGIC);
+    return fseeko(file_, offset_, SEEK_SET) == 0;
+}
+
+bool ResultReader::read_index() {
+    index_.clear();
+    if (fseeko(file_, 0, SEEK_END) != 0) {
+        return false;
+    }
+    end_ = ftello(file_);
+    char footer[INDEX_FOOTER_SIZE];
+    if (end_ < sizeof(RESULT_MAGIC) + INDEX_FOOTER_SIZE ||
+        fseeko(file_, end_ - INDEX_FOOTER_SIZE, SEEK_SET) != 0 ||
+        fread(footer, 1, INDEX_FOOTER_SIZE, file_) != INDEX_FOOTER_SIZE ||
+        memcmp(footer + 12, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+        // no index, records run to the end of file
+        return true;
+    }
+    const char* p = footer;
+    uint64_t index_offset = get<uint64_t>(&p);
+    uint32_t entries = get<uint32_t>(&p);
+    if (index_offset + entries * INDEX_ENTRY_SIZE + INDEX_FOOTER_SIZE != end_) {
+        return false;
+    }
+    std::vector<char> buffer(entries * INDEX_ENTRY_SIZE);
+    if (fseeko(file_, index_offset, SEEK_SET) != 0 ||
+        (entries > 0 && fread(&buffer[0], 1, buffer.size(), file_) != buffer.size())) {
+        return false;
+    }
+    p = buffer.empty() ? NULL : &buffer[0];
+    index_.resize(entries);
+    for (uint32_t i = 0; i < entries; i++) {
+        index_[i].ts = get<int32_t>(&p);
+        index_[i].offset = get<uint64_t>(&p);
+    }
+    end_ = index_offset;
+    return true;
+}
+
+bool ResultReader::seek(const int& ts) {
+    if (!file_) {
+        return false;
+    }
+    // start from the last indexed record before ts, then scan forward
+    uint64_t start = sizeof(RESULT_MAGIC);
+    for (size_t i = 0; i < index_.size() && index_[i].ts < ts; i++) {
+        start = index_[i].offset;
+    }
+    offset_ = start;
+    if (fseeko(file_, offset_, SEEK_SET) != 0) {
+        return false;
+    }
+    FrameStatus status;
+    while (true) {
+        uint64_t record = offset_;
+        if (!read(&status)) {
+            return false;
+        }
+        if (status.ts >= ts) {
+            offset_ = record;
+            return fseeko(file_, offset_, SEEK_SET) == 0;
+        }
+    }
+}
+
+bool ResultReader::read(FrameStatus* status) {
+    // a record that does not end exactly at the end of records is an error, not the end
+    error_ = file_ && offset_ != end_;
+    char fixed[RECORD_FIXED_SIZE];
+    if (!file_ || offset_ + RECORD_FIXED_SIZE > end_ || fread(fixed, 1, RECORD_FIXED_SIZE, file_) != RECORD_FIXED_SIZE) {
+        return false;
+    }
+    const char* p = fixed;
+    status->ts = get<int32_t>(&p);
+    status->joystick_angle = get<double>(&p);
+    status->spell1_cd = get<int32_t>(&p);
+    status->spell2_cd = get<int32_t>(&p);
+    status->spell3_cd = get<int32_t>(&p);
+    status->skill1_cd = get<int32_t>(&p);
+    status->skill2_cd = get<int32_t>(&p);
+    status->skill3_cd = get<int32_t>(&p);
+    status->skill4_cd = get<int32_t>(&p);
+    status->money = get<int32_t>(&p);
+    uint32_t hero_count = get<uint32_t>(&p);
+    if (hero_count > MAX_HEROES_PER_RECORD || offset_ + RECORD_FIXED_SIZE + hero_count * HERO_SIZE > end_) {
+        return false;
+    }
+    offset_ += RECORD_FIXED_SIZE + hero_count * HERO_SIZE;
+
+    status->hero_list.resize(hero_count);
+    for (uint32_t i = 0; i < hero_count; i++) {
+        char hero[HERO_SIZE];
+        if (fread(hero, 1, HERO_SIZE, file_) != HERO_SIZE) {
+            return false;
+        }
+        const char* q = hero;
+        status->hero_list[i].hero_id = get<int32_t>(&q);
+        status->hero_list[i].position.x = get<int32_t>(&q);
+        status->hero_list[i].position.y = get<int32_t>(&q);
+        status->hero_list[i].level = get<int32_t>(&q);
+    }
+    error_ = false;
+    return true;
+}
+
+void ResultReader::close() {
+    if (file_) {
+        fclose(file_);
+        file_ = NULL;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef RESULT_FILE_H
+#define RESULT_FILE_H
+
+#include <cstdio>
+#include <stdint.h>
+#include "game_video.h"
+
+// Binary per-frame result file (.gvr), little endian.
+// header: "GVR1"
+// record: int32 ts, float64 joystick_angle, int32 spell1-3_cd, skill1-4_cd, money,
+//         uint32 hero count, {int32 hero_id, x, y, level} per hero
+// optional sparse index after the last record:
+//         {int32 ts, uint64 offset} per entry, uint64 index offset, uint32 entries, "GVRI"
+
+struct ResultIndexEntry {
+    int ts;
+    uint64_t offset;    // file offset of the record
+};
+
+class ResultWriter {
+  private:
+    FILE* file_;
+    std::vector<char> buffer_;
+    uint64_t offset_;
+    size_t records_;
+    size_t index_interval_;
+    std::vector<ResultIndexEntry> index_;
+
+  public:
+    ResultWriter();
+    ~ResultWriter();
+    // index_interval > 0 appends an index entry every index_interval records
+    bool open(const std::string& path, const size_t& index_interval = 0);
+    bool write(const FrameStatus&);
+    // writes the index, flushes and closes, false if any write failed
+    bool close();
+};
+
+class ResultReader {
+  private:
+    FILE* file_;
+    uint64_t offset_;
+    uint64_t end_;    // start of the index, or end of file
+    bool error_;
+    std::vector<ResultIndexEntry> index_;
+
+    bool read_index();
+
+  public:
+    ResultReader();
+    ~ResultReader();
+    bool open(const std::string& path);
+    // false at end of records, or on a truncated or corrupted record, which error() tells apart
+    bool read(FrameStatus*);
+    // the last read failed before the end of records
+    inline bool error() const {
+        return error_;
+    }
+    // positions before the first record with timestamp >= ts, using the index when there is one
+    bool seek(const int& ts);
+    void close();
+    inline const std::vector<ResultIndexEntry>& index() const {
+        return index_;
+    }
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <map>
+#include <queue>
+#include "result_merge.h"
+#include "result_file.h"
+
+// the tracker never revives a hero missing for 3000ms, so older id mappings can be dropped
+static const int HERO_ID_RETENTION_MS = 10000;
+
+struct GlobalHeroId {
+    int id;
+    int last_seen;
+};
+
+struct ShardCursor {
+    std::string path;
+    ResultReader reader;
+    FrameStatus head;
+    std::map<int, GlobalHeroId> hero_ids;    // local id -> global id
+};
+
+// min-heap on (ts, shard order)
+typedef std::pair<int, size_t> CursorKey;
+
+static void delete_cursors(std::vector<ShardCursor*>* cursors) {
+    for (size_t i = 0; i < cursors->size(); i++) {
+        delete (*cursors)[i];
+    }
+    cursors->clear();
+}
+
+static void prune_hero_ids(ShardCursor* shard, const int& ts) {
+    for (std::map<int, GlobalHeroId>::iterator it = shard->hero_ids.begin(); it != shard->hero_ids.end();) {
+        if (ts - it->second.last_seen > HERO_ID_RETENTION_MS) {
+            shard->hero_ids.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool merge_result_files(const std::vector<std::string>& shards, const std::string& output, const size_t& index_interval, MergeStats* stats) {
+    stats->frames_read = 0;
+    stats->frames_written = 0;
+    stats->duplicates = 0;
+    stats->heroes = 0;
+
+    // open all shards and order them by their first timestamp
+    std::vector<ShardCursor*> cursors;
+    for (size_t i = 0; i < shards.size(); i++) {
+        ShardCursor* cursor = new ShardCursor;
+        cursor->path = shards[i];
+        bool opened = cursor->reader.open(shards[i]);
+        if (opened && cursor->reader.read(&cursor->head)) {
+            cursors.push_back(cursor);
+            continue;
+        }
+        bool empty = opened && !cursor->reader.error();
+        delete cursor;
+        if (!empty) {
+            std::cerr << (opened ? "Truncated or corrupted result file " : "Cannot read result file ") << shards[i] << std::endl;
+            delete_cursors(&cursors);
+            return false;
+        }
+    }
+    std::stable_sort(cursors.begin(), cursors.end(), [](const ShardCursor* a, const ShardCursor* b) {
+        return a->head.ts < b->head.ts;
+    });
+
+    std::priority_queue<CursorKey, std::vector<CursorKey>, std::greater<CursorKey> > heap;
+    for (size_t i = 0; i < cursors.size(); i++) {
+        heap.push(CursorKey(cursors[i]->head.ts, i));
+    }
+
+    ResultWriter writer;
+    bool ok = writer.open(output, index_interval);
+    int next_hero_id = 0;
+    std::vector<size_t> same_ts;
+    while (ok && !heap.empty()) {
+        // all shards holding a frame with the smallest timestamp, earliest shard first
+        int ts = heap.top().first;
+        same_ts.clear();
+        while (!heap.empty() && heap.top().first == ts) {
+            same_ts.push_back(heap.top().second);
+            heap.pop();
+        }
+        stats->frames_read += same_ts.size();
+        stats->duplicates += same_ts.size() - 1;
+
+        ShardCursor* kept = cursors[same_ts[0]];
+        FrameStatus& status = kept->head;
+        for (size_t h = 0; h < status.hero_list.size(); h++) {
+            HeroStatus& hero = status.hero_list[h];
+            std::map<int, GlobalHeroId>::iterator it = kept->hero_ids.find(hero.hero_id);
+            if (it == kept->hero_ids.end()) {
+                GlobalHeroId global = {next_hero_id++, ts};
+                it = kept->hero_ids.insert(std::make_pair(hero.hero_id, global)).first;
+            }
+            it->second.last_seen = ts;
+            hero.hero_id = it->second.id;
+        }
+        ok = writer.write(status);
+
+        // duplicates of the frame tell which global ids the other shards' local ids belong to
+        for (size_t k = 1; k < same_ts.size(); k++) {
+            ShardCursor* duplicate = cursors[same_ts[k]];
+            const std::vector<HeroStatus>& heroes = duplicate->head.hero_list;
+            for (size_t h = 0; h < heroes.size(); h++) {
+                for (size_t g = 0; g < status.hero_list.size(); g++) {
+                    const HeroStatus& global = status.hero_list[g];
+                    if (global.level == heroes[h].level &&
+                        abs(global.position.x - heroes[h].position.x) <= 2 &&
+                        abs(global.position.y - heroes[h].position.y) <= 2) {
+                        GlobalHeroId id = {global.hero_id, ts};
+                        duplicate->hero_ids[heroes[h].hero_id] = id;
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (size_t k = 0; k < same_ts.size(); k++) {
+            ShardCursor* cursor = cursors[same_ts[k]];
+            if (stats->frames_written % 1000 == 0) {
+                prune_hero_ids(cursor, ts);
+            }
+            if (cursor->reader.read(&cursor->head)) {
+                heap.push(CursorKey(cursor->head.ts, same_ts[k]));
+            } else if (cursor->reader.error()) {
+                std::cerr << "Truncated or corrupted result file " << cursor->path << " after " << ts << "ms" << std::endl;
+                ok = false;
+            }
+        }
+        stats->frames_written++;
+    }
+    ok = writer.close() && ok;
+    stats->heroes = next_hero_id;
+
+    delete_cursors(&cursors);
+    return ok;
+}
+
+int run_merge(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "usage: game_video --merge <output.gvr> <shard.gvr>... [--index-interval 256]" << std::endl;
+        return -1;
+    }
+    std::string output = argv[2];
+    size_t index_interval = 256;
+    std::vector<std::string> shards;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--index-interval" && i + 1 < argc) {
+            index_interval = std::max(1, std::atoi(argv[++i]));
+        } else {
+            shards.push_back(arg);
+        }
+    }
+
+    MergeStats stats;
+    if (!merge_result_files(shards, output, index_interval, &stats)) {
+        std::cerr << "Merging into " << output << " failed" << std::endl;
+        return -1;
+    }
+    std::cout << "Merged " << shards.size() << " shard(s), " << stats.frames_read << " frames read, "
+              << stats.duplicates << " overlapping frame(s) dropped, " << stats.frames_written << " frames and "
+              << stats.heroes << " heroes written to " << output << std::endl;
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef RESULT_MERGE_H
+#define RESULT_MERGE_H
+
+#include "game_video.h"
+
+// Streaming k-way merge of per-shard result files of one match into a compacted, indexed file.
+// Shards are merged by timestamp. Frames analyzed by several shards (chunk overlap) are kept once,
+// from the shard that started earliest, since its hero tracking is warmed up. Shard local hero ids
+// are remapped into one global id space, matching heroes of overlapping frames by position and level.
+// Memory only holds one record per shard and the ids of recently seen heroes.
+
+struct MergeStats {
+    size_t frames_read;
+    size_t frames_written;
+    size_t duplicates;
+    int heroes;
+};
+
+bool merge_result_files(const std::vector<std::string>& shards, const std::string& output, const size_t& index_interval, MergeStats*);
+
+// usage: game_video --merge <output.gvr> <shard.gvr>... [--index-interval 256]
+int run_merge(int argc, char** argv);
+
+#endif
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <sys/stat.h>
+#include "slow_frames.h"
+
+static bool faster(const SlowFrame& a, const SlowFrame& b) {
+    return a.total_ms > b.total_ms;
+}
+
+SlowFrameTracker::SlowFrameTracker(const size_t& capacity, const std::string& dump_folder)
+    : capacity_(capacity), dump_folder_(dump_folder) {
+    frames_.reserve(capacity);
+    if (capacity_ > 0 && !dump_folder_.empty()) {
+        // frames that cannot be written are reported without a dump
+        mkdir(dump_folder_.c_str(), 0775);
+    }
+}
+
+void SlowFrameTracker::before_frame(const cv::Mat& frame) {
+    if (capacity_ > 0 && !dump_folder_.empty()) {
+        frame.copyTo(original_);
+    }
+}
+
+bool SlowFrameTracker::add(const size_t& index, const int& ts, const double& total_ms, const double* stage_ms, const StreamState& stream) {
+    if (capacity_ == 0 || (frames_.size() == capacity_ && total_ms <= frames_.front().total_ms)) {
+        return false;
+    }
+    if (frames_.size() == capacity_) {
+        std::pop_heap(frames_.begin(), frames_.end(), faster);
+        if (!frames_.back().dump_path.empty()) {
+            remove(frames_.back().dump_path.c_str());
+        }
+        frames_.pop_back();
+    }
+    SlowFrame frame;
+    frame.index = index;
+    frame.ts = ts;
+    frame.total_ms = total_ms;
+    for (size_t s = 0; s < STAGE_COUNT; s++) {
+        frame.stage_ms[s] = stage_ms ? stage_ms[s] : 0;
+    }
+    frame.candidates = stream.level_candidates;
+    frame.detections = stream.level_detections.size();
+    frame.tracks = stream.heroes_list.size();
+    frame.deferred = stream.deferred_regions.size();
+    if (!dump_folder_.empty() && !original_.empty()) {
+        // lossless, a replay sees exactly the pixels that were slow
+        std::ostringstream path;
+        path << dump_folder_ << "/slow_" << index << ".png";
+        if (cv::imwrite(path.str(), original_)) {
+            frame.dump_path = path.str();
+        }
+    }
+    frames_.push_back(frame);
+    std::push_heap(frames_.begin(), frames_.end(), faster);
+    return true;
+}
+
+std::vector<SlowFrame> SlowFrameTracker::slowest() const {
+    std::vector<SlowFrame> frames = frames_;
+    std::sort_heap(frames.begin(), frames.end(), faster);
+    return frames;
+}
+
+void SlowFrameTracker::print(std::ostream& out) const {
+    std::vector<SlowFrame> frames = slowest();
+    if (frames.empty()) {
+        return;
+    }
+    out << "Slowest " << frames.size() << " frames:" << std::endl;
+    out << "Index\tTs\tTotal(ms)";
+    for (size_t s = 0; s < STAGE_COUNT; s++) {
+        out << '\t' << frame_stage_name(s);
+    }
+    out << "\tBlobs\tLevels\tTracks\tDeferred\tDump" << std::endl;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const SlowFrame& frame = frames[i];
+        out << frame.index << '\t' << frame.ts << '\t' << frame.total_ms;
+        for (size_t s = 0; s < STAGE_COUNT; s++) {
+            out << '\t' << frame.stage_ms[s];
+        }
+        out << '\t' << frame.candidates << '\t' << frame.detections << '\t' << frame.tracks << '\t' << frame.deferred << '\t'
+            << (frame.dump_path.empty() ? "-" : frame.dump_path) << std::endl;
+    }
+}
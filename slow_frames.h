@@ -0,0 +1,44 @@
+#ifndef SLOW_FRAMES_H
+#define SLOW_FRAMES_H
+
+#include "game_video.h"
+
+// The k slowest frames of a run with what made them slow: per-stage latency, the blobs the level
+// search considered, level detections and tracked heroes. Tail latency comes from rare frames
+// (team fights with hundreds of blobs), so with a dump folder each of these frames is also saved
+// as slow_<index>.png before the analysis drew on it, to be replayed with --benchmark --replay.
+
+struct SlowFrame {
+    size_t index;
+    int ts;
+    double total_ms;
+    double stage_ms[STAGE_COUNT];
+    size_t candidates;    // blobs considered by the level search
+    size_t detections;    // levels read
+    size_t tracks;        // heroes tracked after the frame
+    size_t deferred;      // level regions left unsearched at the deadline
+    std::string dump_path;    // empty unless dumped
+};
+
+class SlowFrameTracker {
+  private:
+    size_t capacity_;
+    std::string dump_folder_;
+    std::vector<SlowFrame> frames_;    // min-heap on total_ms
+    cv::Mat original_;
+
+  public:
+    explicit SlowFrameTracker(const size_t& capacity, const std::string& dump_folder = "");
+    // copies the frame before the analysis draws on it, only when frames are dumped
+    void before_frame(const cv::Mat& frame);
+    // records the frame if it is among the slowest so far; stage_ms may be NULL
+    bool add(const size_t& index, const int& ts, const double& total_ms, const double* stage_ms, const StreamState& stream);
+    // slowest first
+    std::vector<SlowFrame> slowest() const;
+    void print(std::ostream&) const;
+    inline bool enabled() const {
+        return capacity_ > 0;
+    }
+};
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef SOAK_TEST_H
+#define SOAK_TEST_H
+
+// Long running stability check for live deployment.
+// Feeds GameVideoAnalyzer with synthetic frames for a configurable duration, samples RSS,
+// per-stage latency percentiles and track counts periodically, and fails (returns non-zero)
+// if memory or p99 latency trends upward beyond tolerance, or the live tracks (and the drained
+// status list) grow.
+//
+// usage: game_video --soak <seconds> [--fps 30] [--realtime] [--interval 10] [--mem-tol 0.05]
+//                   [--lat-tol 0.2] [--count-tol 0.5] [--drain] [--seed 0] [--samples ../samples] [--status-ring <path>]
+int run_soak_test(int argc, char** argv);
+
+#endif
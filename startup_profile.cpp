@@ -0,0 +1,45 @@
+#include <ctime>
+#include "startup_profile.h"
+
+int64_t startup_clock_ns() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+// taken during static initialization, before main()
+static const int64_t PROCESS_START_NS = startup_clock_ns();
+
+StartupProfile::StartupProfile() : start_ns_(PROCESS_START_NS) {}
+
+void StartupProfile::mark(const std::string& phase) {
+    Phase p = {phase, startup_clock_ns()};
+    phases_.push_back(p);
+}
+
+double StartupProfile::elapsed_ms(const std::string& phase) const {
+    for (size_t i = 0; i < phases_.size(); i++) {
+        if (phases_[i].name == phase) {
+            return (phases_[i].end_ns - start_ns_) / 1e6;
+        }
+    }
+    return -1;
+}
+
+void StartupProfile::print(std::ostream& out) const {
+    out << "Startup:";
+    int64_t last = start_ns_;
+    for (size_t i = 0; i < phases_.size(); i++) {
+        out << (i == 0 ? " " : ", ") << phases_[i].name << ' ' << (phases_[i].end_ns - last) / 1e6 << "ms";
+        last = phases_[i].end_ns;
+    }
+    out << "; " << (last - start_ns_) / 1e6 << "ms in total" << std::endl;
+}
+
+void StartupProfile::print_raw(std::ostream& out) const {
+    out << "startup\tstart\t" << start_ns_ << '\n';
+    for (size_t i = 0; i < phases_.size(); i++) {
+        out << "startup\t" << phases_[i].name << '\t' << phases_[i].end_ns << '\n';
+    }
+    out.flush();
+}
@@ -0,0 +1,38 @@
+#ifndef STARTUP_PROFILE_H
+#define STARTUP_PROFILE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Wall-clock phases of a process start up to its first FrameStatus: loading samples, applying the
+// pipeline profile (OpenCV starts its worker threads there), the first decode and the first frame,
+// which also pays for first-touch allocations. Short clips in batch runs spend much of their
+// runtime here. Phases are timed from the process's static initialization, so a "main" mark at
+// the top of main() shows what the dynamic loader and OpenCV's static constructors cost.
+
+int64_t startup_clock_ns();    // CLOCK_MONOTONIC, comparable across processes
+
+class StartupProfile {
+  private:
+    struct Phase {
+        std::string name;
+        int64_t end_ns;
+    };
+    int64_t start_ns_;
+    std::vector<Phase> phases_;
+
+  public:
+    StartupProfile();
+    // ends the phase running since the previous mark, or since the start
+    void mark(const std::string& phase);
+    // ms from the start to the end of the phase, -1 if not marked
+    double elapsed_ms(const std::string& phase) const;
+    // one line: each phase's duration and the total
+    void print(std::ostream&) const;
+    // "startup\t<phase>\t<end ns>" lines for another process, see run_cold_start
+    void print_raw(std::ostream&) const;
+};
+
+#endif
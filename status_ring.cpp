@@ -0,0 +1,249 @@
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "status_ring.h"
+
+static const char RING_MAGIC[8] = {'G', 'V', 'R', 'I', 'N', 'G', '1', '\0'};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "ring sequence numbers must be plain 64-bit words");
+
+int64_t ring_clock_ns() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+static inline size_t ring_size(const uint32_t& capacity) {
+    return sizeof(RingHeader) + static_cast<size_t>(capacity) * sizeof(RingSlot);
+}
+
+StatusRingWriter::StatusRingWriter() : header_(NULL), slots_(NULL), size_(0), next_(0) {}
+
+StatusRingWriter::~StatusRingWriter() {
+    close();
+}
+
+// maps a complete ring file, header_size bytes of it when header_only, NULL if it is not one
+static RingHeader* map_ring(const std::string& path, const bool& writable, const bool& header_only, size_t* size) {
+    int fd = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(RingHeader)) {
+        *size = header_only ? sizeof(RingHeader) : st.st_size;
+        data = mmap(NULL, *size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    RingHeader* header = static_cast<RingHeader*>(data);
+    const uint32_t capacity = header->capacity;
+    if (memcmp(header->magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0 || header->slot_size != sizeof(RingSlot) ||
+        capacity == 0 || (capacity & (capacity - 1)) != 0 || (!header_only && ring_size(capacity) > *size)) {
+        munmap(data, *size);
+        return NULL;
+    }
+    return header;
+}
+
+bool StatusRingWriter::create(const std::string& path, const uint32_t& capacity) {
+    close();
+    uint32_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    // readers map the whole file, so an existing ring is replaced rather than resized under them
+    const std::string tmp = path + ".tmp." + std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t size = ring_size(slots);
+    void* data = ftruncate(fd, size) == 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    header_ = static_cast<RingHeader*>(data);
+    slots_ = reinterpret_cast<RingSlot*>(static_cast<char*>(data) + sizeof(RingHeader));
+    size_ = size;
+    next_ = 0;
+
+    header_->slot_size = sizeof(RingSlot);
+    header_->capacity = slots;
+    header_->replaced.store(0, std::memory_order_relaxed);
+    header_->head.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slots; i++) {
+        slots_[i].seq.store(0, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header_->magic, RING_MAGIC, sizeof(RING_MAGIC));
+
+    size_t old_size = 0;
+    RingHeader* old = map_ring(path, true, true, &old_size);
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        if (old) {
+            munmap(old, old_size);
+        }
+        unlink(tmp.c_str());
+        close();
+        return false;
+    }
+    if (old) {
+        // readers of the old ring finish it, then open the new one
+        old->replaced.store(1, std::memory_order_release);
+        munmap(old, old_size);
+    }
+    return true;
+}
+
+void StatusRingWriter::write(StatusRecord* record) {
+    if (!header_) {
+        return;
+    }
+    record->produced_ns = ring_clock_ns();
+    RingSlot& slot = slots_[next_ & (header_->capacity - 1)];
+    slot.seq.store(2 * next_ + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot.record, record, sizeof(StatusRecord));
+    slot.seq.store(2 * next_ + 2, std::memory_order_release);
+    next_++;
+    header_->head.store(next_, std::memory_order_release);
+}
+
+void StatusRingWriter::close() {
+    if (header_) {
+        munmap(header_, size_);
+    }
+    header_ = NULL;
+    slots_ = NULL;
+    size_ = 0;
+}
+
+StatusRingReader::StatusRingReader() : header_(NULL), slots_(NULL), size_(0), next_(0), missed_(0) {}
+
+StatusRingReader::~StatusRingReader() {
+    close();
+}
+
+bool StatusRingReader::open(const std::string& path) {
+    close();
+    size_t size = 0;
+    const RingHeader* header = map_ring(path, false, false, &size);
+    if (!header) {
+        return false;
+    }
+    path_ = path;
+    header_ = header;
+    slots_ = reinterpret_cast<const RingSlot*>(reinterpret_cast<const char*>(header) + sizeof(RingHeader));
+    size_ = size;
+    next_ = header_->head.load(std::memory_order_acquire);
+    missed_ = 0;
+    return true;
+}
+
+bool StatusRingReader::follow_replacement() {
+    size_t size = 0;
+    const RingHeader* header = map_ring(path_, false, false, &size);
+    if (!header) {
+        return false;
+    }
+    munmap(const_cast<RingHeader*>(header_), size_);
+    header_ = header;
+    slots_ = reinterpret_cast<const RingSlot*>(reinterpret_cast<const char*>(header) + sizeof(RingHeader));
+    size_ = size;
+    next_ = 0;
+    return true;
+}
+
+void StatusRingReader::close() {
+    if (header_) {
+        munmap(const_cast<RingHeader*>(header_), size_);
+    }
+    header_ = NULL;
+    slots_ = NULL;
+    size_ = 0;
+}
+
+bool StatusRingReader::read_slot(const uint64_t& n, StatusRecord* record) const {
+    const RingSlot& slot = slots_[n & (header_->capacity - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != 2 * n + 2) {
+        return false;
+    }
+    memcpy(record, &slot.record, sizeof(StatusRecord));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // the producer did not start another record in this slot meanwhile
+    return slot.seq.load(std::memory_order_relaxed) == 2 * n + 2;
+}
+
+RingReadResult StatusRingReader::next(StatusRecord* record) {
+    if (!header_) {
+        return RING_EMPTY;
+    }
+    // the flag is set after the last record, so head is final once it is seen
+    const bool replaced = header_->replaced.load(std::memory_order_acquire) != 0;
+    const uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (next_ >= head) {
+        // the producer restarted into a new ring file at the same path
+        if (replaced && follow_replacement()) {
+            return next(record);
+        }
+        return RING_EMPTY;
+    }
+    const uint64_t capacity = header_->capacity;
+    if (head - next_ <= capacity && read_slot(next_, record)) {
+        next_++;
+        return RING_OK;
+    }
+    if (head - next_ < capacity) {
+        // head is published after the record, so this is not reached unless lapped meanwhile
+        return RING_EMPTY;
+    }
+    // lapped: continue at the oldest record the producer cannot reach before the next poll
+    uint64_t oldest = head - capacity + 1;
+    missed_ += oldest - next_;
+    next_ = oldest;
+    return RING_LAPPED;
+}
+
+bool StatusRingReader::wait(StatusRecord* record, const int& timeout_ms) {
+    const int64_t deadline = ring_clock_ns() + static_cast<int64_t>(timeout_ms) * 1000000;
+    for (int polls = 0;; polls++) {
+        RingReadResult result = next(record);
+        if (result == RING_OK) {
+            return true;
+        }
+        if (result == RING_LAPPED) {
+            continue;
+        }
+        if (polls >= 1000) {
+            if (ring_clock_ns() > deadline) {
+                return false;
+            }
+            // past the spin phase, frames are tens of milliseconds apart
+            if (polls >= 2000) {
+                timespec pause = {0, 50000};
+                nanosleep(&pause, NULL);
+            } else {
+                sched_yield();
+            }
+        }
+    }
+}
+
+bool StatusRingReader::latest(StatusRecord* record) const {
+    if (!header_) {
+        return false;
+    }
+    const uint64_t head = header_->head.load(std::memory_order_acquire);
+    return head > 0 && read_slot(head - 1, record);
+}
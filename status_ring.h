@@ -0,0 +1,110 @@
+#ifndef STATUS_RING_H
+#define STATUS_RING_H
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+// Shared-memory ring of per-frame results for live consumers in other local processes
+// (overlays, bots). One producer, any number of readers, no locks and no syscalls per record.
+// The ring is a memory-mapped file, by default on tmpfs (/dev/shm). Records are fixed size with
+// the heroes inline; each slot carries a sequence number written before and after the record
+// (a seqlock), so a reader detects records being written or overwritten while it copies them.
+// Readers that fall more than the capacity behind skip to the oldest record still in the ring.
+// A ring file is never resized: the producer restarting, maybe with another capacity, writes a new
+// ring under a temporary name, renames it over the old one and flags the old one replaced, so a
+// reader keeps its mapping valid and moves on to the new file once it read the old one to its end.
+// This header and status_ring.cpp do not depend on OpenCV, consumers build them on their own;
+// conversions from and to FrameStatus are in live_status.h.
+
+#define RING_MAX_HEROES 16
+#define RING_COOLDOWNS 7
+
+struct RingHero {
+    int32_t hero_id;
+    int32_t x;
+    int32_t y;
+    int32_t level;
+};
+
+struct StatusRecord {
+    int64_t produced_ns;    // CLOCK_MONOTONIC when the record was published
+    int32_t ts;
+    int32_t money;
+    double joystick_angle;
+    int32_t cooldowns[RING_COOLDOWNS];    // spell1-3, skill1-4
+    uint32_t hero_count;                  // at most RING_MAX_HEROES, further heroes are dropped
+    RingHero heroes[RING_MAX_HEROES];
+};
+
+// file layout: RingHeader, then capacity slots
+struct RingHeader {
+    char magic[8];    // "GVRING1", written last by the producer
+    uint32_t slot_size;
+    uint32_t capacity;
+    std::atomic<uint32_t> replaced;    // set once a new ring took this file's path, after its last record
+    alignas(64) std::atomic<uint64_t> head;    // records published so far
+};
+
+struct alignas(64) RingSlot {
+    std::atomic<uint64_t> seq;    // 2n + 1 while record n is written, 2n + 2 once it is complete
+    StatusRecord record;
+};
+
+int64_t ring_clock_ns();
+
+class StatusRingWriter {
+  private:
+    RingHeader* header_;
+    RingSlot* slots_;
+    size_t size_;
+    uint64_t next_;
+
+  public:
+    StatusRingWriter();
+    ~StatusRingWriter();
+    // creates the ring file or replaces an existing one, capacity is rounded up to a power of two
+    bool create(const std::string& path, const uint32_t& capacity = 1024);
+    // publishes the record, stamping produced_ns
+    void write(StatusRecord* record);
+    void close();
+};
+
+enum RingReadResult {
+    RING_OK = 0,
+    RING_EMPTY,     // no new record yet
+    RING_LAPPED     // records were overwritten before they were read, the reader skipped ahead
+};
+
+class StatusRingReader {
+  private:
+    std::string path_;
+    const RingHeader* header_;
+    const RingSlot* slots_;
+    size_t size_;
+    uint64_t next_;
+    uint64_t missed_;
+
+    bool read_slot(const uint64_t& n, StatusRecord* record) const;
+    // maps the ring now at path_ in place of the replaced one, from its first record
+    bool follow_replacement();
+
+  public:
+    StatusRingReader();
+    ~StatusRingReader();
+    // starts at the next record published after opening
+    bool open(const std::string& path);
+    void close();
+    // next record in order; on RING_LAPPED call again to read the oldest record left
+    RingReadResult next(StatusRecord* record);
+    // polls for the next record, spinning first and then sleeping briefly, false on timeout
+    bool wait(StatusRecord* record, const int& timeout_ms);
+    // newest complete record without advancing, false if none
+    bool latest(StatusRecord* record) const;
+    // records skipped after being lapped
+    inline uint64_t missed() const {
+        return missed_;
+    }
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "synthetic_frames.h"
+
+SyntheticFrameGenerator::SyntheticFrameGenerator(const NumberSamples& samples, const int& fps, const unsigned& seed, const int& num_heroes, const int& clutter)
+    : samples_(&samples), rng_(seed) {
+    frame_interval_ = std::max(1, 1000 / std::max(1, fps));
+    ts_ = 0;
+    clutter_ = clutter;
+    money_ = 300;
+    for (size_t i = 0; i < NUM_COOLDOWNS; i++) {
+        cooldowns_[i] = 0;
+    }
+    joystick_angle_ = 0;
+
+    // heroes walk around the playfield, away from HUD icons
+    for (int i = 0; i < num_heroes; i++) {
+        HeroStatus hero = {i, cv::Point(rng_.uniform(300, 1000), rng_.uniform(80, 480)), rng_.uniform(1, 5)};
+        heroes_.push_back(hero);
+        velocities_.push_back(cv::Point(rng_.uniform(-3, 4), rng_.uniform(-3, 4)));
+    }
+
+    // static dark playfield with some low contrast texture
+    background_.create(720, 1280, CV_8UC3);
+    background_.setTo(cv::Scalar(40, 70, 35));
+    for (size_t i = 0; i < 200; i++) {
+        cv::Point p(rng_.uniform(0, 1280), rng_.uniform(0, 720));
+        cv::Point q = p + cv::Point(rng_.uniform(10, 120), rng_.uniform(10, 80));
+        int v = rng_.uniform(20, 90);
+        cv::rectangle(background_, p, q, cv::Scalar(v, v + 20, v), -1);
+    }
+}
+
+void SyntheticFrameGenerator::draw_number(cv::Mat* frame, const int& number, const std::vector<cv::Mat>& font, const cv::Point& center, const int& height) {
+    std::string digits = std::to_string(number);
+    std::vector<cv::Mat> glyphs;
+    int width = 0;
+    for (size_t i = 0; i < digits.size(); i++) {
+        const cv::Mat& sample = font[digits[i] - '0'];
+        cv::Mat glyph;
+        int glyph_width = std::max(1, sample.cols * height / sample.rows);
+        cv::resize(sample, glyph, cv::Size(glyph_width, height), 0, 0, cv::INTER_NEAREST);
+        glyphs.push_back(glyph);
+        width += glyph_width + 2;
+    }
+    int x = center.x - width / 2;
+    int y = center.y - height / 2;
+    for (size_t i = 0; i < glyphs.size(); i++) {
+        cv::Rect box(x, y, glyphs[i].cols, glyphs[i].rows);
+        if ((box & cv::Rect(0, 0, frame->cols, frame->rows)) == box) {
+            (*frame)(box).setTo(cv::Scalar(255, 255, 255), glyphs[i]);
+        }
+        x += glyphs[i].cols + 2;
+    }
+}
+
+void SyntheticFrameGenerator::draw_level_icon(cv::Mat* frame, const HeroStatus& hero) {
+    // dark badge framed by a light gray ring around the level digits, the gray of the real badges
+    const int radius = static_cast<int>(LEVEL_BADGE.radius);
+    cv::circle(*frame, hero.position, radius, cv::Scalar(30, 30, 30), -1);
+    cv::circle(*frame, hero.position, radius, cv::Scalar(120, 135, 135), 2);
+    draw_number(frame, hero.level, samples_->level, hero.position, 14);
+}
+
+void SyntheticFrameGenerator::step() {
+    ts_ += frame_interval_;
+    bool new_second = (ts_ / 1000) != ((ts_ - frame_interval_) / 1000);
+
+    // money grows steadily, with occasional kill bonus
+    if (new_second) {
+        money_ += 5;
+    }
+    if (rng_.uniform(0, 300) == 0) {
+        money_ += rng_.uniform(50, 300);
+    }
+    money_ = std::min(money_, 99999);
+
+    // cooldowns count down every second, idle icons are cast at random
+    for (size_t i = 0; i < NUM_COOLDOWNS; i++) {
+        if (cooldowns_[i] > 0) {
+            if (new_second) {
+                cooldowns_[i]--;
+            }
+        } else if (rng_.uniform(0, 60) == 0) {
+            cooldowns_[i] = rng_.uniform(3, i < 3 ? 90 : 15);
+        }
+    }
+
+    for (size_t i = 0; i < heroes_.size(); i++) {
+        cv::Point& p = heroes_[i].position;
+        p += velocities_[i];
+        if (p.x < 300 || p.x > 1000) {
+            velocities_[i].x = -velocities_[i].x;
+        }
+        if (p.y < 80 || p.y > 480) {
+            velocities_[i].y = -velocities_[i].y;
+        }
+        p.x = std::min(std::max(p.x, 300), 1000);
+        p.y = std::min(std::max(p.y, 80), 480);
+        if (rng_.uniform(0, 900) == 0 && heroes_[i].level < 15) {
+            heroes_[i].level++;
+        }
+    }
+
+    joystick_angle_ += rng_.uniform(-0.2, 0.2);
+}
+
+void SyntheticFrameGenerator::next(cv::Mat* frame, int* ts) {
+    step();
+    background_.copyTo(*frame);
+
+    // skill effects and floating texts produce colored and white blobs all over the frame
+    for (int i = 0; i < clutter_; i++) {
+        cv::Point p(rng_.uniform(0, 1280), rng_.uniform(0, 720));
+        if (i % 2 == 0) {
+            cv::Scalar color(rng_.uniform(0, 256), rng_.uniform(0, 256), rng_.uniform(0, 256));
+            cv::circle(*frame, p, rng_.uniform(4, 30), color, -1);
+        } else {
+            cv::rectangle(*frame, p, p + cv::Point(rng_.uniform(2, 9), rng_.uniform(3, 20)), cv::Scalar(255, 255, 255), -1);
+        }
+    }
+
+    for (size_t i = 0; i < heroes_.size(); i++) {
+        draw_level_icon(frame, heroes_[i]);
+    }
+
+    // HUD
+    (*frame)(MONEY_ROI).setTo(cv::Scalar(20, 20, 20));
+    draw_number(frame, money_, samples_->money, cv::Point(MONEY_ROI.x + MONEY_ROI.width / 2, MONEY_ROI.y + MONEY_ROI.height / 2), 14);
+    for (size_t i = 0; i < NUM_COOLDOWNS; i++) {
+        const int radius = i < 3 ? 52 : 40;
+        cv::circle(*frame, COOLDOWN_CENTERS[i], radius - 4, cv::Scalar(50, 50, 50), -1);
+        if (cooldowns_[i] > 0) {
+            draw_number(frame, cooldowns_[i], samples_->cooldown, COOLDOWN_CENTERS[i], i < 3 ? 28 : 22);
+        }
+    }
+
+    cv::Point axis(206, 559);
+    cv::Point knob = axis + cv::Point(60 * cos(joystick_angle_), -60 * sin(joystick_angle_));
+    cv::circle(*frame, axis, 100, cv::Scalar(120, 120, 120), 2);
+    cv::circle(*frame, knob, 45, cv::Scalar(230, 230, 230), 3);
+
+    *ts = ts_;
+}
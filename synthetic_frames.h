@@ -0,0 +1,41 @@
+#ifndef SYNTHETIC_FRAMES_H
+#define SYNTHETIC_FRAMES_H
+
+#include "game_video.h"
+
+// renders 1280*720 frames with money, cooldown numbers, hero level icons and the virtual joystick
+// drawn from the number samples, so the analyzer can be driven without any recorded video
+class SyntheticFrameGenerator {
+  private:
+    const NumberSamples* samples_;
+    cv::RNG rng_;
+
+    int frame_interval_;    // unit: ms
+    int ts_;
+    int clutter_;           // number of random colored/white blobs per frame
+
+    int money_;
+    int cooldowns_[NUM_COOLDOWNS];
+    double joystick_angle_;
+    std::vector<HeroStatus> heroes_;
+    std::vector<cv::Point> velocities_;
+
+    cv::Mat background_;
+
+    void draw_number(cv::Mat*, const int&, const std::vector<cv::Mat>&, const cv::Point&, const int&);
+    void draw_level_icon(cv::Mat*, const HeroStatus&);
+    void step();
+
+  public:
+    SyntheticFrameGenerator(const NumberSamples&, const int& fps, const unsigned& seed, const int& num_heroes = 6, const int& clutter = 30);
+    // render next frame, timestamps advance by 1000 / fps
+    void next(cv::Mat*, int* ts);
+    inline void set_clutter(const int& clutter) {
+        clutter_ = clutter;
+    }
+    inline const std::vector<HeroStatus>& heroes() const {
+        return heroes_;
+    }
+};
+
+#endif
@@ -0,0 +1,77 @@
+// Replaying a detection log tracks heroes like the live run it was written by, also with --dedup.
+// usage: test_detection_log [samples folder], exits non-zero when a check fails
+#include <unistd.h>
+#include "detection_log.h"
+#include "synthetic_frames.h"
+
+static bool same_heroes(const std::vector<HeroStatus>& a, const std::vector<HeroStatus>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].hero_id != b[i].hero_id || a[i].position != b[i].position || a[i].level != b[i].level) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    NumberSamples samples;
+    if (!load_number_samples(argc > 1 ? argv[1] : "../samples", &samples)) {
+        return 1;
+    }
+    char path[] = "/tmp/test_detection_log_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        std::cout << "Cannot create a temporary file" << std::endl;
+        return 1;
+    }
+    close(fd);
+
+    // every frame twice, as in a 60 fps re-encode of a 30 fps recording, logged like the interactive mode
+    GameVideoAnalyzer game_video_analyzer;
+    game_video_analyzer.set_display(false);
+    game_video_analyzer.set_dedup_tolerance(DEFAULT_DEDUP_TOLERANCE);
+    SyntheticFrameGenerator generator(samples, 30, 5);
+    DetectionLogWriter detection_log;
+    detection_log.open(path);
+    std::vector<std::vector<HeroStatus> > live_lists;
+    cv::Mat frame, copy;
+    for (int i = 0; i < 300; i++) {
+        int ts;
+        generator.next(&frame, &ts);
+        game_video_analyzer.adjust_size(&frame);
+        for (int repeat = 0; repeat < 2; repeat++) {
+            frame.copyTo(copy);
+            FrameStatus status;
+            game_video_analyzer.process_frame(&copy, ts + repeat * 16, samples, &status);
+            if (!game_video_analyzer.last_frame_duplicate()) {
+                detection_log.write(status.ts, game_video_analyzer.level_detections());
+                live_lists.push_back(status.hero_list);
+            }
+        }
+    }
+    bool passed = detection_log.close();
+
+    DetectionLog log;
+    passed = read_detection_log(path, &log) && passed;
+    unlink(path);
+    std::vector<std::vector<HeroStatus> > replay_lists;
+    ReplayStats stats = replay_tracker(log, DEFAULT_TRACKER_PARAMS, &replay_lists);
+    std::cout << game_video_analyzer.duplicate_frames() << " duplicate frames, " << log.frames.size() << " logged, "
+              << game_video_analyzer.heroes_assigned() << " hero ids live, " << stats.heroes_assigned << " replayed" << std::endl;
+
+    passed = passed && game_video_analyzer.duplicate_frames() > 0 && replay_lists.size() == live_lists.size() &&
+             stats.heroes_assigned == game_video_analyzer.heroes_assigned() &&
+             stats.heroes_listed == game_video_analyzer.stream().heroes_list.size() &&
+             stats.heroes_archived == game_video_analyzer.stream().heroes_archived;
+    for (size_t f = 0; passed && f < live_lists.size(); f++) {
+        if (!same_heroes(live_lists[f], replay_lists[f])) {
+            std::cout << "frame " << f << ": " << live_lists[f].size() << " heroes live, " << replay_lists[f].size() << " replayed" << std::endl;
+            passed = false;
+        }
+    }
+    std::cout << (passed ? "PASS" : "FAIL") << ": replayed tracks equal the live ones" << std::endl;
+    return passed ? 0 : 1;
+}
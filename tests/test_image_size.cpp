@@ -0,0 +1,33 @@
+// Frame sizes read from image headers match the decoded images.
+// usage: test_image_size, exits non-zero when a check fails
+#include <unistd.h>
+#include "frame_reader.h"
+
+int main() {
+    char path[] = "/tmp/test_image_size_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+
+    // odd sizes, so swapped or rounded fields show
+    const cv::Mat image(23, 37, CV_8UC3, cv::Scalar(40, 80, 120));
+    const char* extensions[] = {".png", ".bmp", ".jpg"};
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        const std::string file = path + std::string(extensions[i]);
+        cv::Size size;
+        bool matching = cv::imwrite(file, image) && read_image_size(file, &size) && size == cv::imread(file).size();
+        unlink(file.c_str());
+        std::cout << (matching ? "PASS" : "FAIL") << ": " << extensions[i] << " header size " << size.width << "x" << size.height << std::endl;
+        passed = passed && matching;
+    }
+
+    // anything else is left to the decoder
+    cv::Size size;
+    bool unknown = !read_image_size(path, &size);
+    unlink(path);
+    std::cout << (unknown ? "PASS" : "FAIL") << ": no size from an empty file" << std::endl;
+    return passed && unknown ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+// Kernel checks against their reference behavior, OpenCV free like the kernels themselves.
+// usage: test_kernels, exits non-zero when a check fails
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include "kernels.h"
+
+// random binary image of the given density (percent of set pixels)
+static void random_binary(const int& width, const int& height, const int& density, std::vector<unsigned char>* pixels, ImageView* view) {
+    pixels->resize(width * height);
+    for (size_t i = 0; i < pixels->size(); i++) {
+        (*pixels)[i] = rand() % 100 < density ? 255 : 0;
+    }
+    ImageView binary = {&(*pixels)[0], width, height, 1, static_cast<size_t>(width)};
+    *view = binary;
+}
+
+static bool same_blobs(const std::vector<Blob>& a, const std::vector<Blob>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].width != b[i].width || a[i].height != b[i].height || a[i].area != b[i].area) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// stripes labelled apart and merged give exactly the blobs of find_blobs on the whole image,
+// for random sizes, densities and stripe heights (a stripe of one row puts a seam on every row)
+static bool check_stripe_merge() {
+    srand(1);
+    std::vector<unsigned char> pixels;
+    std::vector<Blob> expected, merged;
+    BlobScratch scratch, merge_scratch;
+    std::vector<BlobScratch> stripes;
+    for (int iteration = 0; iteration < 500; iteration++) {
+        const int width = 1 + rand() % 64, height = 1 + rand() % 64;
+        ImageView binary;
+        random_binary(width, height, rand() % 100, &pixels, &binary);
+        find_blobs(binary, &expected, &scratch);
+
+        const int rows = 1 + rand() % 12;
+        const size_t count = (height + rows - 1) / rows;
+        // more stripes than used, merge_stripe_blobs must only read the first count
+        stripes.resize(count + 2);
+        for (size_t s = 0; s < count; s++) {
+            label_runs(binary, s * rows, std::min(height, static_cast<int>(s + 1) * rows), &stripes[s]);
+        }
+        merge_stripe_blobs(stripes, count, &merged, &merge_scratch);
+        if (!same_blobs(expected, merged)) {
+            std::cout << "stripe merge: " << width << "x" << height << " in stripes of " << rows << " rows gives "
+                      << merged.size() << " blobs, find_blobs " << expected.size() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// a coarse cell is set exactly when any pixel of its block (clipped at the borders) is set in the
+// full resolution mask, for random BGR images, scales and sizes not divisible by the scale
+static bool check_downscale_max_pool() {
+    srand(2);
+    std::vector<unsigned char> pixels;
+    ImageBuffer full_buffer, coarse_buffer;
+    for (int iteration = 0; iteration < 300; iteration++) {
+        const int width = 1 + rand() % 50, height = 1 + rand() % 50, scale = 1 + rand() % 4;
+        pixels.resize(width * height * 3);
+        for (size_t i = 0; i < pixels.size(); i++) {
+            pixels[i] = rand() % 256;
+        }
+        const ImageView bgr = {&pixels[0], width, height, 3, static_cast<size_t>(width * 3)};
+        ImageView& full = full_buffer.create(width, height, 1);
+        gray_threshold(bgr, 180, &full);
+        ImageView& coarse = coarse_buffer.create((width + scale - 1) / scale, (height + scale - 1) / scale, 1);
+        gray_threshold_downscale(bgr, 180, scale, &coarse);
+        for (int y = 0; y < coarse.height; y++) {
+            for (int x = 0; x < coarse.width; x++) {
+                unsigned char any = 0;
+                for (int fy = y * scale; fy < std::min(height, (y + 1) * scale); fy++) {
+                    for (int fx = x * scale; fx < std::min(width, (x + 1) * scale); fx++) {
+                        any |= full.row(fy)[fx];
+                    }
+                }
+                if (coarse.row(y)[x] != any) {
+                    std::cout << "downscale: cell " << x << "," << y << " of " << width << "x" << height << " at scale " << scale
+                              << " is " << static_cast<int>(coarse.row(y)[x]) << ", its block " << static_cast<int>(any) << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main() {
+    struct {
+        const char* name;
+        bool (*check)();
+    } checks[] = {
+        {"stripe merge", check_stripe_merge},
+        {"downscale max pool", check_downscale_max_pool},
+    };
+    bool passed = true;
+    for (size_t i = 0; i < sizeof(checks) / sizeof(checks[0]); i++) {
+        bool ok = checks[i].check();
+        std::cout << (ok ? "PASS" : "FAIL") << ": " << checks[i].name << std::endl;
+        passed = passed && ok;
+    }
+    return passed ? 0 : 1;
+}
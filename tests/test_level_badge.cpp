@@ -0,0 +1,73 @@
+// LEVEL_BADGE on real level badges and on the synthetic frames that imitate them.
+// usage: test_level_badge [samples folder], exits non-zero when a check fails
+#include <cmath>
+#include "game_video.h"
+#include "synthetic_frames.h"
+
+// samples/badges.bmp: 48x48 crops of screenshot2.png side by side, centered on the level digits;
+// the first four are badges ("11", "10", "9", "10"), the others the terrain, hero art and bars
+// around them that probe most like a badge
+static const int CROP_SIZE = 48;
+static const int REAL_BADGES = 4;
+static const cv::Rect REAL_DIGITS[REAL_BADGES] = {
+    cv::Rect(16, 18, 17, 13), cv::Rect(14, 17, 20, 15), cv::Rect(20, 18, 9, 13), cv::Rect(14, 17, 20, 14)
+};
+
+static bool check_real_badges(const std::string& samples_folder) {
+    cv::Mat crops = cv::imread(samples_folder + "/badges.bmp", cv::IMREAD_COLOR);
+    if (!crops.data || crops.rows != CROP_SIZE || crops.cols < CROP_SIZE * (REAL_BADGES + 1)) {
+        std::cout << "Cannot load " << samples_folder << "/badges.bmp" << std::endl;
+        return false;
+    }
+    const ImageView frame = image_view(crops);
+    bool passed = true;
+    for (int k = 0; k < crops.cols / CROP_SIZE; k++) {
+        // negatives get an icon the size of a digit pair
+        cv::Rect digits = k < REAL_BADGES ? REAL_DIGITS[k] : cv::Rect(15, 17, 18, 14);
+        digits.x += k * CROP_SIZE;
+        const bool found = has_level_badge(frame, digits);
+        if (found != (k < REAL_BADGES)) {
+            std::cout << "crop " << k << (k < REAL_BADGES ? ": badge not found" : ": badge found in a negative") << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+static bool check_synthetic_badges(const NumberSamples& samples) {
+    SyntheticFrameGenerator generator(samples, 30, 3, 6, 0);
+    cv::Mat frame;
+    int ts;
+    bool passed = true;
+    for (int i = 0; i < 10; i++) {
+        generator.next(&frame, &ts);
+        const std::vector<HeroStatus>& heroes = generator.heroes();
+        for (size_t h = 0; h < heroes.size(); h++) {
+            // badges of overlapping heroes hide each other's rings
+            bool overlapped = false;
+            for (size_t o = 0; o < heroes.size(); o++) {
+                const cv::Point d = heroes[o].position - heroes[h].position;
+                overlapped = overlapped || (o != h && std::hypot(d.x, d.y) < 4 * LEVEL_BADGE.radius);
+            }
+            const cv::Rect digits(heroes[h].position.x - 9, heroes[h].position.y - 7, 18, 14);
+            if (!overlapped && !has_level_badge(image_view(frame), digits)) {
+                std::cout << "frame " << i << ": synthetic badge of hero " << heroes[h].hero_id << " at " << heroes[h].position << " not found" << std::endl;
+                passed = false;
+            }
+        }
+    }
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    const std::string samples_folder = argc > 1 ? argv[1] : "../samples";
+    NumberSamples samples;
+    if (!load_number_samples(samples_folder, &samples)) {
+        return 1;
+    }
+    bool real = check_real_badges(samples_folder);
+    std::cout << (real ? "PASS" : "FAIL") << ": real level badges" << std::endl;
+    bool synthetic = check_synthetic_badges(samples);
+    std::cout << (synthetic ? "PASS" : "FAIL") << ": synthetic level badges" << std::endl;
+    return real && synthetic ? 0 : 1;
+}
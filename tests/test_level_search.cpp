@@ -0,0 +1,88 @@
+// Coarse level discovery against the full resolution search on synthetic frames.
+// usage: test_level_search [samples folder], exits non-zero when a check fails
+#include <algorithm>
+#include "game_video.h"
+#include "synthetic_frames.h"
+
+static bool detection_before(const LevelDetection& a, const LevelDetection& b) {
+    if (a.position.y != b.position.y) {
+        return a.position.y < b.position.y;
+    }
+    if (a.position.x != b.position.x) {
+        return a.position.x < b.position.x;
+    }
+    return a.level < b.level;
+}
+
+static void detect(const GameVideoAnalyzer& analyzer, cv::Mat* frame, const NumberSamples& samples, std::vector<LevelDetection>* detections, size_t* candidates) {
+    cv::Mat copy = frame->clone();
+    analyzer.detect_levels(&copy, samples.level, samples.icon_mask, 0.3, 180, NULL, detections, candidates);
+    std::sort(detections->begin(), detections->end(), detection_before);
+}
+
+// white bars like floating text one pixel right of each level icon's digits, so on the max pooled
+// mask every icon merges with clutter into a blob wider than a level icon
+static void glue_clutter(const std::vector<HeroStatus>& heroes, const NumberSamples& samples, cv::Mat* frame) {
+    for (size_t i = 0; i < heroes.size(); i++) {
+        // the digit layout of SyntheticFrameGenerator::draw_number at height 14
+        const std::string digits = std::to_string(heroes[i].level);
+        int width = 0;
+        for (size_t d = 0; d < digits.size(); d++) {
+            const cv::Mat& sample = samples.level[digits[d] - '0'];
+            width += std::max(1, sample.cols * 14 / sample.rows) + 2;
+        }
+        const int right = heroes[i].position.x - width / 2 + width - 2;
+        cv::Rect bar(right + 1, heroes[i].position.y - 7, 20, 14);
+        bar &= cv::Rect(0, 0, frame->cols, frame->rows);
+        (*frame)(bar).setTo(cv::Scalar(255, 255, 255));
+    }
+}
+
+int main(int argc, char** argv) {
+    NumberSamples samples;
+    if (!load_number_samples(argc > 1 ? argv[1] : "../samples", &samples)) {
+        return 1;
+    }
+    GameVideoAnalyzer full, coarse;
+    full.set_display(false);
+    coarse.set_display(false);
+    coarse.set_coarse_level_discovery(true);
+
+    SyntheticFrameGenerator generator(samples, 30, 7);
+    cv::Mat frame;
+    std::vector<LevelDetection> full_detections, coarse_detections;
+    size_t frames = 0, mismatches = 0, glued_found = 0, glued_expected = 0;
+    for (int i = 0; i < 60; i++) {
+        int ts;
+        generator.next(&frame, &ts);
+        full.adjust_size(&frame);
+        const bool glued = i % 2 == 1;
+        if (glued) {
+            glue_clutter(generator.heroes(), samples, &frame);
+        }
+        size_t full_candidates, coarse_candidates;
+        detect(full, &frame, samples, &full_detections, &full_candidates);
+        detect(coarse, &frame, samples, &coarse_detections, &coarse_candidates);
+        frames++;
+
+        bool same = full_detections.size() == coarse_detections.size();
+        for (size_t d = 0; same && d < full_detections.size(); d++) {
+            same = full_detections[d].position == coarse_detections[d].position && full_detections[d].level == coarse_detections[d].level;
+        }
+        // coarse discovery skips only specks too small for a digit, it labels no more than the full search
+        if (!same || coarse_candidates > full_candidates) {
+            std::cout << "frame " << i << (glued ? " (glued)" : "") << ": full search " << full_detections.size() << " detections of "
+                      << full_candidates << " candidates, coarse " << coarse_detections.size() << " of " << coarse_candidates << std::endl;
+            mismatches++;
+        }
+        if (glued) {
+            glued_expected += generator.heroes().size();
+            glued_found += coarse_detections.size();
+        }
+    }
+    std::cout << glued_found << " level icons found by coarse discovery next to clutter, " << glued_expected << " drawn" << std::endl;
+    bool passed = mismatches == 0 && glued_found > 0;
+    std::cout << (passed ? "PASS" : "FAIL") << ": coarse level discovery matches the full search in " << frames - mismatches << " of "
+              << frames << " frames" << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+// Match boundaries found on probes of a recording with two matches and casting in between.
+// usage: test_match_split, exits non-zero when a check fails
+#include <algorithm>
+#include "match_split.h"
+
+// one frame per second: a match in [0, 300) s, casting without HUD in [300, 400) s, a second
+// match in [400, 800) s
+static const size_t FRAMES = 800;
+static const size_t SECOND_MATCH = 400;
+
+static MatchProbe synthetic_probe(const size_t& index, const std::vector<size_t>& misreads) {
+    MatchProbe probe = {static_cast<int>(index * 1000), false, -1, 0};
+    const bool casting = index >= 300 && index < SECOND_MATCH;
+    const size_t match_s = index < SECOND_MATCH ? index : index - SECOND_MATCH;
+    if (!casting && std::find(misreads.begin(), misreads.end(), index) == misreads.end()) {
+        probe.hud = true;
+        probe.money = 300 + static_cast<int>(match_s) * 20;
+        probe.max_level = 1 + static_cast<int>(match_s / 30);
+    }
+    return probe;
+}
+
+static bool same_segments(const std::vector<MatchSegment>& segments, const size_t& count, const size_t* first, const size_t* last) {
+    if (segments.size() != count) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (segments[i].first != first[i] || segments[i].last != last[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_segments(const std::vector<MatchSegment>& segments) {
+    for (size_t i = 0; i < segments.size(); i++) {
+        std::cout << "    frames [" << segments[i].first << ", " << segments[i].last << "), starts at "
+                  << boundary_cause_name(segments[i].cause) << std::endl;
+    }
+}
+
+static bool split(const std::vector<size_t>& misreads, const MatchSplitOptions& options, std::vector<MatchSegment>* segments) {
+    std::vector<int> timestamps(FRAMES);
+    for (size_t i = 0; i < FRAMES; i++) {
+        timestamps[i] = static_cast<int>(i * 1000);
+    }
+    ProbeFunction probe = [&misreads](const size_t& index, MatchProbe* result) {
+        *result = synthetic_probe(index, misreads);
+        return true;
+    };
+    return find_match_segments(probe, timestamps, options, segments);
+}
+
+int main() {
+    const size_t first[] = {0, SECOND_MATCH}, last[] = {300, FRAMES};
+    std::vector<MatchSegment> segments;
+
+    std::vector<size_t> misreads;
+    bool clean = split(misreads, DEFAULT_MATCH_SPLIT_OPTIONS, &segments) && same_segments(segments, 2, first, last);
+    std::cout << (clean ? "PASS" : "FAIL") << ": two matches around casting" << std::endl;
+    print_segments(segments);
+
+    // money not read on the frame of one sample in the middle of the first match
+    misreads.push_back(150);
+    bool dropped = split(misreads, DEFAULT_MATCH_SPLIT_OPTIONS, &segments) && same_segments(segments, 2, first, last);
+    std::cout << (dropped ? "PASS" : "FAIL") << ": one dropped money reading does not split a match" << std::endl;
+    print_segments(segments);
+
+    // without the gap requirement the misread sample ends the first match
+    MatchSplitOptions single = DEFAULT_MATCH_SPLIT_OPTIONS;
+    single.hud_gap_samples = 1;
+    single.min_segment_ms = 0;
+    bool undebounced = split(misreads, single, &segments) && segments.size() == 3;
+    std::cout << (undebounced ? "PASS" : "FAIL") << ": a single sample gap splits with --hud-gap 1" << std::endl;
+    print_segments(segments);
+    return clean && dropped && undebounced ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+// Pipeline profiles apply only to the host and frame size they were calibrated for.
+// usage: test_pipeline_profile, exits non-zero when a check fails
+#include <unistd.h>
+#include "auto_tuner.h"
+#include "thread_policy.h"
+
+static bool same_params(const PipelineParams& a, const PipelineParams& b) {
+    return a.num_threads == b.num_threads && a.roi_batch == b.roi_batch && a.read_ahead == b.read_ahead;
+}
+
+int main() {
+    char path[] = "/tmp/test_pipeline_profile_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+    const std::string profile = std::string(path) + ".yml";
+
+    // without a profile OpenCV's pool keeps every core of the budget
+    GameVideoAnalyzer analyzer;
+    apply_pipeline_params(DEFAULT_PIPELINE_PARAMS, &analyzer);
+    bool defaults = cv::getNumThreads() == thread_budget();
+    std::cout << (defaults ? "PASS" : "FAIL") << ": default pipeline threads on " << cv::getNumThreads() << " of "
+              << thread_budget() << " threads" << std::endl;
+
+    const PipelineParams calibrated = {2, 4, 1};
+    CalibrationOptions options = DEFAULT_CALIBRATION_OPTIONS;
+    options.frame_size = cv::Size(1920, 1080);
+    const BenchmarkResult result = BenchmarkResult();
+    bool saved = save_pipeline_profile(profile, calibrated, options, result);
+
+    PipelineParams params = DEFAULT_PIPELINE_PARAMS;
+    bool matching = saved && load_pipeline_profile(profile, cv::Size(1920, 1080), &params) && same_params(params, calibrated);
+    std::cout << (matching ? "PASS" : "FAIL") << ": profile of the input's frame size loaded" << std::endl;
+
+    params = DEFAULT_PIPELINE_PARAMS;
+    bool mismatching = saved && !load_pipeline_profile(profile, cv::Size(1280, 720), &params) && same_params(params, DEFAULT_PIPELINE_PARAMS);
+    std::cout << (mismatching ? "PASS" : "FAIL") << ": profile of another frame size ignored" << std::endl;
+
+    unlink(path);
+    unlink(profile.c_str());
+    return defaults && matching && mismatching ? 0 : 1;
+}
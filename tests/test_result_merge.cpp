@@ -0,0 +1,81 @@
+// Merging result shards, and failing on a truncated one instead of taking it for its end.
+// usage: test_result_merge, exits non-zero when a check fails
+#include <unistd.h>
+#include "result_file.h"
+#include "result_merge.h"
+
+static std::string temp_path(const char* name) {
+    char path[] = "/tmp/test_result_merge_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) {
+        close(fd);
+        unlink(path);
+    }
+    return std::string(path) + "_" + name;
+}
+
+// frames of ts in [first_ts, end_ts), 40ms apart, with a hero on every frame
+static bool write_shard(const std::string& path, const int& first_ts, const int& end_ts) {
+    ResultWriter writer;
+    if (!writer.open(path)) {
+        return false;
+    }
+    bool ok = true;
+    for (int ts = first_ts; ts < end_ts; ts += 40) {
+        FrameStatus status = FrameStatus();
+        status.ts = ts;
+        status.money = ts / 100;
+        HeroStatus hero = {0, cv::Point(400 + ts % 200, 300), 1 + ts / 10000};
+        status.hero_list.push_back(hero);
+        ok = writer.write(status) && ok;
+    }
+    return writer.close() && ok;
+}
+
+static bool truncate_file(const std::string& path, const off_t& bytes) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    fseeko(file, 0, SEEK_END);
+    off_t size = ftello(file);
+    fclose(file);
+    return truncate(path.c_str(), size - bytes) == 0;
+}
+
+int main() {
+    const std::string first = temp_path("a.gvr"), second = temp_path("b.gvr"), output = temp_path("out.gvr");
+    // the second shard overlaps the first by 25 frames
+    bool passed = write_shard(first, 0, 20000) && write_shard(second, 19000, 40000);
+    std::vector<std::string> shards;
+    shards.push_back(first);
+    shards.push_back(second);
+
+    MergeStats stats;
+    bool merged = passed && merge_result_files(shards, output, 256, &stats);
+    bool complete = merged && stats.frames_written == 1000 && stats.duplicates == 25;
+    std::cout << (complete ? "PASS" : "FAIL") << ": merge of complete shards" << std::endl;
+
+    // a record cut in the middle, as a worker killed while writing leaves it
+    bool truncated = passed && truncate_file(second, 7);
+    bool rejected = truncated && !merge_result_files(shards, output, 256, &stats);
+    const char* argv[] = {"game_video", "--merge", output.c_str(), first.c_str(), second.c_str()};
+    bool exit_code = truncated && run_merge(5, const_cast<char**>(argv)) != 0;
+    std::cout << (rejected && exit_code ? "PASS" : "FAIL") << ": merge of a truncated shard fails" << std::endl;
+
+    ResultReader reader;
+    FrameStatus status;
+    size_t frames = 0;
+    bool opened = truncated && reader.open(second);
+    while (opened && reader.read(&status)) {
+        frames++;
+    }
+    bool reported = opened && reader.error() && frames == 524;
+    std::cout << (reported ? "PASS" : "FAIL") << ": reader tells the truncated record from the end" << std::endl;
+    reader.close();
+
+    unlink(first.c_str());
+    unlink(second.c_str());
+    unlink(output.c_str());
+    return complete && rejected && exit_code && reported ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+// A reader following the status ring while the producer restarts it with other capacities.
+// usage: test_status_ring, exits non-zero when a check fails
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include "status_ring.h"
+
+// publishes count records with ts first_ts, first_ts + 1, ...
+static void publish(StatusRingWriter* writer, const int& first_ts, const int& count) {
+    StatusRecord record;
+    memset(&record, 0, sizeof(record));
+    for (int i = 0; i < count; i++) {
+        record.ts = first_ts + i;
+        writer->write(&record);
+    }
+}
+
+// reads until the ring is empty, false unless the records are ts first_ts, first_ts + 1, ... up to end_ts
+static bool read_in_order(StatusRingReader* reader, const int& first_ts, const int& end_ts) {
+    StatusRecord record;
+    int expected = first_ts;
+    RingReadResult result;
+    while ((result = reader->next(&record)) != RING_EMPTY) {
+        if (result == RING_OK && record.ts != expected++) {
+            std::cout << "read ts " << record.ts << ", expected " << expected - 1 << std::endl;
+            return false;
+        }
+    }
+    if (expected != end_ts) {
+        std::cout << "read up to ts " << expected << ", expected " << end_ts << std::endl;
+    }
+    return expected == end_ts;
+}
+
+int main() {
+    char path[] = "/tmp/test_status_ring_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+    const std::string ring = std::string(path) + ".ring";
+
+    StatusRingWriter writer;
+    StatusRingReader reader;
+    bool passed = writer.create(ring, 16) && reader.open(ring);
+    publish(&writer, 0, 10);
+    bool first = passed && read_in_order(&reader, 0, 10);
+    std::cout << (first ? "PASS" : "FAIL") << ": records of the first ring" << std::endl;
+
+    // restarted with a larger ring, the reader's mapping of the small one stays valid; its records
+    // past the small ring's capacity would lie beyond that mapping if the file were resized in place
+    publish(&writer, 10, 3);
+    passed = writer.create(ring, 1024);
+    publish(&writer, 13, 500);
+    bool grown = passed && read_in_order(&reader, 10, 513);
+    std::cout << (grown ? "PASS" : "FAIL") << ": reader finishes the old ring and follows into a larger one" << std::endl;
+
+    // and back to a smaller one, which would cut the larger mapping short
+    publish(&writer, 513, 4);
+    passed = writer.create(ring, 8);
+    publish(&writer, 517, 6);
+    bool shrunk = passed && read_in_order(&reader, 513, 523) && reader.missed() == 0;
+    std::cout << (shrunk ? "PASS" : "FAIL") << ": reader follows into a smaller ring" << std::endl;
+
+    reader.close();
+    writer.close();
+    unlink(path);
+    unlink(ring.c_str());
+    return first && grown && shrunk ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+// Window aggregation over column stores whose chunks are in and out of timestamp order.
+// usage: test_window_query, exits non-zero when a check fails
+#include <algorithm>
+#include <unistd.h>
+#include "window_query.h"
+
+// chunks of 4 frames 100ms apart, starting at the given timestamps
+static bool write_store(const std::string& path, const std::vector<int>& chunk_starts) {
+    ColumnWriter writer;
+    if (!writer.open(path, 4)) {
+        return false;
+    }
+    bool ok = true;
+    for (size_t c = 0; c < chunk_starts.size(); c++) {
+        for (int f = 0; f < 4; f++) {
+            FrameStatus status = FrameStatus();
+            status.ts = chunk_starts[c] + f * 100;
+            status.money = status.ts / 10;
+            ok = writer.write(status) && ok;
+        }
+    }
+    return writer.close() && ok;
+}
+
+// counts per 500ms window, -1 when the query fails
+static std::vector<int> window_counts(const std::string& path) {
+    std::vector<int> counts;
+    ColumnReader reader;
+    WindowQuery query = {AGG_COUNT, COL_TS, 500, 500, std::vector<ColumnPredicate>()};
+    std::vector<WindowResult> results;
+    if (!reader.open(path) || !run_window_query(reader, query, &results)) {
+        counts.push_back(-1);
+        return counts;
+    }
+    for (size_t i = 0; i < results.size(); i++) {
+        counts.push_back(static_cast<int>(results[i].frames));
+    }
+    return counts;
+}
+
+static std::string print(const std::vector<int>& counts) {
+    std::string text;
+    for (size_t i = 0; i < counts.size(); i++) {
+        text += (i > 0 ? " " : "") + std::to_string(counts[i]);
+    }
+    return text;
+}
+
+int main() {
+    char path[] = "/tmp/test_window_query_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+    const std::string store = std::string(path) + ".gvc";
+    std::vector<int> expected;
+    expected.push_back(4);
+    expected.push_back(0);
+    expected.push_back(4);
+
+    std::vector<int> starts;
+    starts.push_back(0);
+    starts.push_back(1000);
+    bool sorted = write_store(store, starts) && window_counts(store) == expected;
+    std::cout << (sorted ? "PASS" : "FAIL") << ": windows of chunks in timestamp order, " << print(window_counts(store)) << std::endl;
+
+    // the second chunk starts before the first one, its panes come before the first chunk's
+    std::reverse(starts.begin(), starts.end());
+    bool backwards = write_store(store, starts) && window_counts(store) == expected;
+    std::cout << (backwards ? "PASS" : "FAIL") << ": windows of a chunk going backwards, " << print(window_counts(store)) << std::endl;
+
+    unlink(path);
+    unlink(store.c_str());
+    return sorted && backwards ? 0 : 1;
+}
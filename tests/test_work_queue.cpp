@@ -0,0 +1,222 @@
+// Lease claim, expiry and reclaim between worker processes racing on one queue folder.
+// usage: test_work_queue, exits non-zero when a check fails
+#include <chrono>
+#include <thread>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "work_queue.h"
+
+static const int64 TTL_MS = 300;
+static const int RECLAIMERS = 6;
+
+typedef std::chrono::system_clock::time_point TimePoint;
+
+static TimePoint after_ms(const TimePoint& start, const int64& ms) {
+    return start + std::chrono::milliseconds(ms);
+}
+
+static WorkItem make_item(const int& round) {
+    WorkItem item = {"item_" + std::to_string(round), "frames", 0, 1};
+    return item;
+}
+
+// forks a worker process, the token of a worker is its host, pid and start time; the exit code is
+// what body returns
+template <typename Body>
+static pid_t fork_worker(const std::string& queue_dir, Body body) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        QueueWorker worker(queue_dir, TTL_MS, 3);
+        _exit(body(&worker));
+    }
+    return pid;
+}
+
+static int exit_code(const pid_t& pid) {
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+// claims start together on a fresh item, exactly one wins
+static bool check_claim(const std::string& queue_dir) {
+    const WorkItem item = make_item(0);
+    const TimePoint start = after_ms(std::chrono::system_clock::now(), 100);
+    std::vector<pid_t> workers;
+    for (int k = 0; k < RECLAIMERS; k++) {
+        workers.push_back(fork_worker(queue_dir, [&](QueueWorker* worker) {
+            std::this_thread::sleep_until(start);
+            return worker->try_claim(item) ? 0 : 1;
+        }));
+    }
+    int claimed = 0;
+    for (size_t k = 0; k < workers.size(); k++) {
+        claimed += exit_code(workers[k]) == 0 ? 1 : 0;
+    }
+    if (claimed != 1) {
+        std::cout << claimed << " workers claimed the same fresh item" << std::endl;
+    }
+    return claimed == 1;
+}
+
+// the owner stalls past its lease: exactly one worker reclaims it, the owner's heartbeat then fails,
+// and its release leaves the new lease alone
+static bool check_expire_and_reclaim(const std::string& queue_dir) {
+    const WorkItem item = make_item(1);
+    const TimePoint start = after_ms(std::chrono::system_clock::now(), 100);
+    pid_t owner = fork_worker(queue_dir, [&](QueueWorker* worker) {
+        std::this_thread::sleep_until(start);
+        if (!worker->try_claim(item)) {
+            return 2;
+        }
+        std::this_thread::sleep_until(after_ms(start, TTL_MS + 150));
+        const bool lost = !worker->renew(item) && !worker->owns(item);
+        worker->release(item);
+        return lost ? 0 : 1;
+    });
+    std::vector<pid_t> reclaimers;
+    for (int k = 0; k < RECLAIMERS; k++) {
+        reclaimers.push_back(fork_worker(queue_dir, [&](QueueWorker* worker) {
+            std::this_thread::sleep_until(after_ms(start, TTL_MS + 50));
+            return worker->try_claim(item) ? 0 : 1;
+        }));
+    }
+    int reclaimed = 0;
+    for (size_t k = 0; k < reclaimers.size(); k++) {
+        reclaimed += exit_code(reclaimers[k]) == 0 ? 1 : 0;
+    }
+    const int owner_code = exit_code(owner);
+    // the reclaimed lease is still valid after the stalled owner released its own
+    pid_t late = fork_worker(queue_dir, [&](QueueWorker* worker) {
+        return worker->try_claim(item) ? 1 : 0;
+    });
+    const bool kept = exit_code(late) == 0;
+    if (owner_code != 0 || reclaimed != 1 || !kept) {
+        std::cout << "expired lease: owner exit " << owner_code << ", " << reclaimed << " reclaims, reclaimed lease "
+                  << (kept ? "kept" : "lost") << " after the owner's release" << std::endl;
+    }
+    return owner_code == 0 && reclaimed == 1 && kept;
+}
+
+// the owner's heartbeat lands right at the expiry, among reclaims spread around it: either the
+// heartbeat keeps the lease or one reclaim takes it, never both
+static bool check_renew_race(const std::string& queue_dir, const int& rounds) {
+    bool passed = true;
+    int renewed = 0;
+    for (int round = 0; round < rounds; round++) {
+        const WorkItem item = make_item(2 + round);
+        const TimePoint start = after_ms(std::chrono::system_clock::now(), 50);
+        pid_t owner = fork_worker(queue_dir, [&](QueueWorker* worker) {
+            std::this_thread::sleep_until(start);
+            if (!worker->try_claim(item)) {
+                return 2;
+            }
+            std::this_thread::sleep_until(after_ms(start, TTL_MS));
+            return worker->renew(item) ? 0 : 1;
+        });
+        std::vector<pid_t> reclaimers;
+        for (int k = 0; k < RECLAIMERS; k++) {
+            reclaimers.push_back(fork_worker(queue_dir, [&](QueueWorker* worker) {
+                std::this_thread::sleep_until(after_ms(start, TTL_MS - 3 + k * 2));
+                return worker->try_claim(item) ? 0 : 1;
+            }));
+        }
+        int reclaimed = 0;
+        for (size_t k = 0; k < reclaimers.size(); k++) {
+            reclaimed += exit_code(reclaimers[k]) == 0 ? 1 : 0;
+        }
+        const int owner_code = exit_code(owner);
+        renewed += owner_code == 0 ? 1 : 0;
+        if (owner_code < 0 || owner_code > 1 || (owner_code == 0) + reclaimed != 1) {
+            std::cout << "round " << round << ": owner exit " << owner_code << ", " << reclaimed << " reclaims" << std::endl;
+            passed = false;
+        }
+    }
+    std::cout << renewed << " of " << rounds << " heartbeats kept their lease" << std::endl;
+    return passed;
+}
+
+// one worker alone failing an item every time: each failure counts, and after max_attempts it stops
+// claiming the item instead of retrying it forever
+static bool check_failing_item(const std::string& queue_dir) {
+    const WorkItem item = make_item(100);
+    pid_t worker = fork_worker(queue_dir, [&](QueueWorker* worker) {
+        int attempts = 0;
+        while (attempts <= 3 && worker->try_claim(item)) {
+            attempts++;
+            worker->mark_failed(item);
+            worker->release(item);
+        }
+        return attempts == 3 && worker->failed_attempts(item) == 3 ? 0 : 1;
+    });
+    const bool stopped = exit_code(worker) == 0;
+    if (!stopped) {
+        std::cout << "a single worker retried a failing item past its attempts" << std::endl;
+    }
+    return stopped;
+}
+
+// files in the lease folder of an item
+static int lease_files(const std::string& queue_dir, const WorkItem& item) {
+    DIR* dir = opendir((queue_dir + "/leases/" + item.id).c_str());
+    if (!dir) {
+        return 0;
+    }
+    int files = 0;
+    while (struct dirent* entry = readdir(dir)) {
+        files += entry->d_name[0] != '.' ? 1 : 0;
+    }
+    closedir(dir);
+    return files;
+}
+
+// heartbeats of a long item leave the two newest generations, not one file per heartbeat
+static bool check_generations_pruned(const std::string& queue_dir) {
+    const WorkItem item = make_item(200);
+    pid_t worker = fork_worker(queue_dir, [&](QueueWorker* worker) {
+        bool renewed = worker->try_claim(item);
+        for (int k = 0; k < 50 && renewed; k++) {
+            renewed = worker->renew(item);
+        }
+        return renewed && worker->owns(item) ? 0 : 1;
+    });
+    const bool owned = exit_code(worker) == 0;
+    const int files = lease_files(queue_dir, item);
+    if (!owned || files > 2) {
+        std::cout << "after 50 heartbeats the lease " << (owned ? "is held" : "was lost") << " with " << files << " generation files" << std::endl;
+    }
+    return owned && files <= 2;
+}
+
+int main() {
+    char queue_dir[] = "/tmp/test_work_queue_XXXXXX";
+    if (!mkdtemp(queue_dir)) {
+        return 1;
+    }
+    const std::string leases = std::string(queue_dir) + "/leases", done = std::string(queue_dir) + "/done",
+                      failed = std::string(queue_dir) + "/failed";
+    mkdir(leases.c_str(), 0775);
+    mkdir(done.c_str(), 0775);
+    mkdir(failed.c_str(), 0775);
+
+    bool claim = check_claim(queue_dir);
+    std::cout << (claim ? "PASS" : "FAIL") << ": one claim of a fresh item" << std::endl;
+    bool reclaim = check_expire_and_reclaim(queue_dir);
+    std::cout << (reclaim ? "PASS" : "FAIL") << ": one reclaim of an expired lease" << std::endl;
+    bool race = check_renew_race(queue_dir, 10);
+    std::cout << (race ? "PASS" : "FAIL") << ": heartbeat racing reclaims" << std::endl;
+    bool failing = check_failing_item(queue_dir);
+    std::cout << (failing ? "PASS" : "FAIL") << ": a single worker gives up a failing item" << std::endl;
+    bool pruned = check_generations_pruned(queue_dir);
+    std::cout << (pruned ? "PASS" : "FAIL") << ": old lease generations are removed" << std::endl;
+
+    const std::string cleanup = "rm -rf " + std::string(queue_dir);
+    if (system(cleanup.c_str()) != 0) {
+        std::cout << "Cannot remove " << queue_dir << std::endl;
+    }
+    return claim && reclaim && race && failing && pruned ? 0 : 1;
+}
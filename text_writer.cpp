@@ -0,0 +1,280 @@
+#include <cmath>
+#include <stdint.h>
+#include "text_writer.h"
+
+static const size_t TEXT_BUFFER_SIZE = 1 << 20;
+// room for every fixed field of one frame, and for one hero
+static const size_t FRAME_RESERVE = 512;
+static const size_t HERO_RESERVE = 128;
+
+static const char* TEXT_FIELD_NAMES[FIELD_COUNT] = {"ts", "joystick_angle", "spell1_cd", "spell2_cd", "spell3_cd",
+                                                    "skill1_cd", "skill2_cd", "skill3_cd", "skill4_cd", "money", "heroes"};
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// writes the digits of value ending right before end, returns the first digit
+static inline char* format_digits(uint64_t value, char* end) {
+    while (value >= 100) {
+        const size_t pair = (value % 100) * 2;
+        value /= 100;
+        *--end = DIGIT_PAIRS[pair + 1];
+        *--end = DIGIT_PAIRS[pair];
+    }
+    if (value >= 10) {
+        *--end = DIGIT_PAIRS[value * 2 + 1];
+        *--end = DIGIT_PAIRS[value * 2];
+    } else {
+        *--end = static_cast<char>('0' + value);
+    }
+    return end;
+}
+
+const char* text_field_name(const int& field) {
+    return field >= 0 && field < FIELD_COUNT ? TEXT_FIELD_NAMES[field] : "unknown";
+}
+
+bool parse_text_fields(const std::string& list, unsigned* fields) {
+    *fields = 0;
+    size_t begin = 0;
+    while (begin <= list.size()) {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string name = list.substr(begin, end - begin);
+        int field = 0;
+        while (field < FIELD_COUNT && name != TEXT_FIELD_NAMES[field]) {
+            field++;
+        }
+        if (field == FIELD_COUNT) {
+            std::cerr << "Unknown field " << name << std::endl;
+            return false;
+        }
+        *fields |= 1u << field;
+        begin = end + 1;
+    }
+    return *fields != 0;
+}
+
+TextWriter::TextWriter() : file_(NULL), format_(NDJSON), fields_(ALL_TEXT_FIELDS), size_(0), ok_(false) {}
+
+TextWriter::~TextWriter() {
+    close();
+}
+
+bool TextWriter::open(const std::string& path, const Format& format, const unsigned& fields) {
+    close();
+    file_ = path == "-" ? stdout : fopen(path.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    format_ = format;
+    fields_ = fields & ALL_TEXT_FIELDS;
+    buffer_.resize(TEXT_BUFFER_SIZE);
+    size_ = 0;
+    ok_ = true;
+
+    // CSV header row
+    if (format_ == HERO_CSV) {
+        const char header[] = "ts,hero_id,x,y,level\n";
+        append(header, sizeof(header) - 1);
+    } else if (format_ == CSV) {
+        bool first = true;
+        for (int field = 0; field < FIELD_COUNT; field++) {
+            if (fields_ & (1u << field)) {
+                if (!first) {
+                    append(',');
+                }
+                append(TEXT_FIELD_NAMES[field], strlen(TEXT_FIELD_NAMES[field]));
+                first = false;
+            }
+        }
+        append('\n');
+    }
+    return true;
+}
+
+void TextWriter::flush() {
+    if ((size_ > 0 && fwrite(&buffer_[0], 1, size_, file_) != size_) || fflush(file_) != 0) {
+        ok_ = false;
+    }
+    size_ = 0;
+}
+
+void TextWriter::append_int(const int& value) {
+    char digits[12];
+    char* end = digits + sizeof(digits);
+    // negate in 64 bits so INT_MIN does not overflow
+    int64_t wide = value;
+    char* begin = format_digits(wide < 0 ? -wide : wide, end);
+    if (wide < 0) {
+        *--begin = '-';
+    }
+    append(begin, end - begin);
+}
+
+void TextWriter::append_angle(const double& angle) {
+    if (!std::isfinite(angle)) {
+        if (format_ == NDJSON) {
+            append("null", 4);
+        }
+        return;
+    }
+    // fixed point with two decimals
+    const int64_t hundredths = static_cast<int64_t>(std::floor(std::fabs(angle) * 100 + 0.5));
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* begin = end;
+    const size_t frac = (hundredths % 100) * 2;
+    *--begin = DIGIT_PAIRS[frac + 1];
+    *--begin = DIGIT_PAIRS[frac];
+    *--begin = '.';
+    begin = format_digits(hundredths / 100, begin);
+    if (angle < 0 && hundredths != 0) {
+        *--begin = '-';
+    }
+    append(begin, end - begin);
+}
+
+bool TextWriter::write(const FrameStatus& status) {
+    if (!file_) {
+        return false;
+    }
+    if (format_ == NDJSON) {
+        write_ndjson(status);
+    } else if (format_ == CSV) {
+        write_csv(status);
+    } else {
+        for (size_t i = 0; i < status.hero_list.size(); i++) {
+            const HeroStatus& hero = status.hero_list[i];
+            reserve(HERO_RESERVE);
+            append_int(status.ts);
+            append(',');
+            append_int(hero.hero_id);
+            append(',');
+            append_int(hero.position.x);
+            append(',');
+            append_int(hero.position.y);
+            append(',');
+            append_int(hero.level);
+            append('\n');
+        }
+    }
+    return ok_;
+}
+
+static inline void frame_ints(const FrameStatus& status, int* values) {
+    values[FIELD_TS] = status.ts;
+    values[FIELD_SPELL1_CD] = status.spell1_cd;
+    values[FIELD_SPELL2_CD] = status.spell2_cd;
+    values[FIELD_SPELL3_CD] = status.spell3_cd;
+    values[FIELD_SKILL1_CD] = status.skill1_cd;
+    values[FIELD_SKILL2_CD] = status.skill2_cd;
+    values[FIELD_SKILL3_CD] = status.skill3_cd;
+    values[FIELD_SKILL4_CD] = status.skill4_cd;
+    values[FIELD_MONEY] = status.money;
+}
+
+void TextWriter::write_ndjson(const FrameStatus& status) {
+    int values[FIELD_COUNT];
+    frame_ints(status, values);
+    reserve(FRAME_RESERVE);
+    append('{');
+    bool first = true;
+    for (int field = 0; field < FIELD_COUNT; field++) {
+        if (!(fields_ & (1u << field))) {
+            continue;
+        }
+        if (!first) {
+            append(',');
+        }
+        first = false;
+        append('"');
+        append(TEXT_FIELD_NAMES[field], strlen(TEXT_FIELD_NAMES[field]));
+        append("\":", 2);
+        if (field == FIELD_JOYSTICK_ANGLE) {
+            append_angle(status.joystick_angle);
+        } else if (field == FIELD_HEROES) {
+            append('[');
+            for (size_t i = 0; i < status.hero_list.size(); i++) {
+                const HeroStatus& hero = status.hero_list[i];
+                reserve(HERO_RESERVE);
+                append(i == 0 ? "{\"hero_id\":" : ",{\"hero_id\":", i == 0 ? 11 : 12);
+                append_int(hero.hero_id);
+                append(",\"x\":", 5);
+                append_int(hero.position.x);
+                append(",\"y\":", 5);
+                append_int(hero.position.y);
+                append(",\"level\":", 9);
+                append_int(hero.level);
+                append('}');
+            }
+            reserve(FRAME_RESERVE);
+            append(']');
+        } else {
+            append_int(values[field]);
+        }
+    }
+    append("}\n", 2);
+}
+
+void TextWriter::write_csv(const FrameStatus& status) {
+    int values[FIELD_COUNT];
+    frame_ints(status, values);
+    reserve(FRAME_RESERVE);
+    bool first = true;
+    for (int field = 0; field < FIELD_COUNT; field++) {
+        if (!(fields_ & (1u << field))) {
+            continue;
+        }
+        if (!first) {
+            append(',');
+        }
+        first = false;
+        if (field == FIELD_JOYSTICK_ANGLE) {
+            append_angle(status.joystick_angle);
+        } else if (field == FIELD_HEROES) {
+            for (size_t i = 0; i < status.hero_list.size(); i++) {
+                const HeroStatus& hero = status.hero_list[i];
+                reserve(HERO_RESERVE);
+                if (i > 0) {
+                    append(';');
+                }
+                append_int(hero.hero_id);
+                append(':');
+                append_int(hero.position.x);
+                append(':');
+                append_int(hero.position.y);
+                append(':');
+                append_int(hero.level);
+            }
+            reserve(FRAME_RESERVE);
+        } else {
+            append_int(values[field]);
+        }
+    }
+    append('\n');
+}
+
+bool TextWriter::close() {
+    if (!file_) {
+        return true;
+    }
+    flush();
+    ok_ = fflush(file_) == 0 && ok_;
+    if (file_ != stdout) {
+        ok_ = fclose(file_) == 0 && ok_;
+    }
+    file_ = NULL;
+    return ok_;
+}
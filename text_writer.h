@@ -0,0 +1,78 @@
+#ifndef TEXT_WRITER_H
+#define TEXT_WRITER_H
+
+#include <cstdio>
+#include <cstring>
+#include "game_video.h"
+
+// NDJSON and CSV writers for FrameStatus, formatting straight into a large output buffer
+// without iostreams or printf. Integers are formatted two digits at a time, joystick_angle
+// with two decimals (non-finite angles are written as null / an empty field).
+
+enum TextField {
+    FIELD_TS = 0,
+    FIELD_JOYSTICK_ANGLE,
+    FIELD_SPELL1_CD,
+    FIELD_SPELL2_CD,
+    FIELD_SPELL3_CD,
+    FIELD_SKILL1_CD,
+    FIELD_SKILL2_CD,
+    FIELD_SKILL3_CD,
+    FIELD_SKILL4_CD,
+    FIELD_MONEY,
+    FIELD_HEROES,
+    FIELD_COUNT
+};
+
+const unsigned ALL_TEXT_FIELDS = (1u << FIELD_COUNT) - 1;
+
+const char* text_field_name(const int&);
+// comma separated field names, e.g. "ts,money,heroes", false on an unknown name
+bool parse_text_fields(const std::string& list, unsigned* fields);
+
+class TextWriter {
+  public:
+    enum Format {
+        NDJSON = 0,    // one JSON object per frame, heroes as an array of objects
+        CSV,           // one row per frame, heroes as "hero_id:x:y:level" joined by ';'
+        HERO_CSV       // one row per hero: ts, hero_id, x, y, level
+    };
+
+    TextWriter();
+    ~TextWriter();
+    // path "-" writes to stdout; fields is a mask of (1 << TextField), ignored by HERO_CSV
+    bool open(const std::string& path, const Format& format, const unsigned& fields = ALL_TEXT_FIELDS);
+    bool write(const FrameStatus&);
+    // writes out the buffered text, e.g. after each frame of a live stream
+    void flush();
+    // flushes and closes, false if any write failed
+    bool close();
+
+  private:
+    FILE* file_;
+    Format format_;
+    unsigned fields_;
+    std::vector<char> buffer_;
+    size_t size_;
+    bool ok_;
+
+    // makes room for n more bytes
+    inline void reserve(const size_t& n) {
+        if (size_ + n > buffer_.size()) {
+            flush();
+        }
+    }
+    inline void append(const char* text, const size_t& n) {
+        memcpy(&buffer_[size_], text, n);
+        size_ += n;
+    }
+    inline void append(const char c) {
+        buffer_[size_++] = c;
+    }
+    void append_int(const int&);
+    void append_angle(const double&);
+    void write_ndjson(const FrameStatus&);
+    void write_csv(const FrameStatus&);
+};
+
+#endif
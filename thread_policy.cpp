@@ -0,0 +1,27 @@
+#include <algorithm>
+#include <atomic>
+#include <opencv2/core/utility.hpp>
+#include "thread_policy.h"
+
+static std::atomic<int> process_share(1);
+static std::atomic<int> current_level(PARALLEL_IN_FRAME);
+
+int thread_budget() {
+    return std::max(1, cv::getNumberOfCPUs() / process_share.load());
+}
+
+void set_process_share(const int& processes) {
+    process_share = std::max(1, processes);
+}
+
+int use_threads(const ParallelLevel& level, const int& requested, const int& reserved) {
+    const int available = std::max(1, thread_budget() - std::max(0, reserved));
+    const int threads = requested < 0 ? available : std::min(requested, available);
+    cv::setNumThreads(threads);
+    current_level = level;
+    return threads;
+}
+
+ParallelLevel parallel_level() {
+    return static_cast<ParallelLevel>(current_level.load());
+}
@@ -0,0 +1,36 @@
+#ifndef THREAD_POLICY_H
+#define THREAD_POLICY_H
+
+// The one place that decides how many threads the process computes with, and at which level.
+// OpenCV 3 cannot take an external parallel backend, so there is a single pool, OpenCV's: our
+// ParallelLoopBody loops and OpenCV's own (resize, cvtColor, HoughCircles, findContours) all run
+// on it, and a parallel_for_ called from one of its workers runs serially. Oversubscription comes
+// from sizing that pool in several places, from threads beside it and from processes sharing the
+// machine, so every mode sizes the pool here once, for the level it parallelizes:
+// - PARALLEL_IN_FRAME: one stream with frames in order; the pool serves OpenCV's loops and the
+//   cooldown ROI batches of each frame (interactive mode, benchmark, soak test, worker items).
+// - PARALLEL_ACROSS_TASKS: segments, probes or column chunks run in parallel on the pool, and
+//   everything inside a task is serial, cooldown ROI batches included.
+// Threads outside the pool, like the read-ahead decoder, are reserved from the same budget, and
+// forked worker processes split the machine between them.
+
+enum ParallelLevel {
+    PARALLEL_IN_FRAME = 0,
+    PARALLEL_ACROSS_TASKS
+};
+
+// threads this process may use: the machine's, divided among the processes sharing it
+int thread_budget();
+
+// this many processes started together share the machine, e.g. forked workers; call before forking
+void set_process_share(const int& processes);
+
+// sizes OpenCV's pool for the level: the requested threads, < 0 for the whole budget, capped by
+// the budget less the reserved threads that run beside the pool; 0 disables threading.
+// Returns the pool size.
+int use_threads(const ParallelLevel& level, const int& requested, const int& reserved = 0);
+
+// level of the last use_threads, PARALLEL_IN_FRAME before any
+ParallelLevel parallel_level();
+
+#endif
@@ -0,0 +1,302 @@
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "window_query.h"
+#include "thread_policy.h"
+
+static const char* AGGREGATE_NAMES[AGG_COUNT_ALL] = {"count", "min", "max", "mean", "rate", "rises"};
+
+// partial aggregate of the frames of one pane, mergeable in timestamp order
+struct Pane {
+    size_t frames;
+    double sum;
+    double min;
+    double max;
+    int first_ts;
+    int last_ts;
+    double first;
+    double last;
+    size_t rises;
+};
+
+static void merge_pane(Pane* into, const Pane& next) {
+    if (next.frames == 0) {
+        return;
+    }
+    if (into->frames == 0) {
+        *into = next;
+        return;
+    }
+    into->rises += next.rises + (next.first > into->last ? 1 : 0);
+    into->frames += next.frames;
+    into->sum += next.sum;
+    into->min = std::min(into->min, next.min);
+    into->max = std::max(into->max, next.max);
+    into->last_ts = next.last_ts;
+    into->last = next.last;
+}
+
+static inline void add_frame(Pane* pane, const int& ts, const double& value) {
+    Pane frame = {1, value, value, value, ts, ts, value, value, 0};
+    merge_pane(pane, frame);
+}
+
+static int gcd(int a, int b) {
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static inline int floor_div(const int& a, const int& b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// panes of one chunk, first_pane is the pane index of panes[0]
+struct ChunkPanes {
+    bool ok;
+    int first_pane;
+    std::vector<Pane> panes;
+};
+
+class WindowScanBody : public cv::ParallelLoopBody {
+  private:
+    const ColumnReader* reader_;
+    const WindowQuery* query_;
+    int pane_ms_;
+    std::vector<ChunkPanes>* results_;
+
+  public:
+    WindowScanBody(const ColumnReader* reader, const WindowQuery* query, const int& pane_ms, std::vector<ChunkPanes>* results)
+        : reader_(reader), query_(query), pane_ms_(pane_ms), results_(results) {}
+
+    void operator()(const cv::Range& range) const {
+        std::vector<double> ts, values, filter_values;
+        std::vector<char> keep;
+        for (int c = range.start; c < range.end; c++) {
+            ChunkPanes& result = (*results_)[c];
+            result.ok = true;
+            result.panes.clear();
+            const ChunkInfo& chunk = reader_->chunk(c);
+            bool skip = false;
+            for (size_t i = 0; i < query_->filters.size() && !skip; i++) {
+                skip = !zone_may_match(query_->filters[i], chunk.columns[query_->filters[i].column].zone);
+            }
+            if (skip) {
+                continue;
+            }
+            const bool need_values = query_->aggregate != AGG_COUNT;
+            if (!reader_->read_column(c, COL_TS, &ts) || (need_values && !reader_->read_column(c, query_->column, &values))) {
+                result.ok = false;
+                continue;
+            }
+            keep.assign(ts.size(), 1);
+            for (size_t i = 0; i < query_->filters.size(); i++) {
+                if (!reader_->read_column(c, query_->filters[i].column, &filter_values)) {
+                    result.ok = false;
+                    break;
+                }
+                for (size_t f = 0; f < filter_values.size(); f++) {
+                    keep[f] = keep[f] && eval_predicate(query_->filters[i], filter_values[f]);
+                }
+            }
+            if (!result.ok || ts.empty()) {
+                continue;
+            }
+            result.first_pane = floor_div(static_cast<int>(ts.front()), pane_ms_);
+            for (size_t f = 0; f < ts.size(); f++) {
+                if (!keep[f]) {
+                    continue;
+                }
+                int pane = floor_div(static_cast<int>(ts[f]), pane_ms_) - result.first_pane;
+                if (pane < 0) {
+                    // timestamps are sorted, keep going on unsorted input rather than fail
+                    continue;
+                }
+                if (static_cast<size_t>(pane) >= result.panes.size()) {
+                    Pane empty = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+                    result.panes.resize(pane + 1, empty);
+                }
+                add_frame(&result.panes[pane], static_cast<int>(ts[f]), need_values ? values[f] : 0);
+            }
+        }
+    }
+};
+
+bool parse_window_aggregate(const std::string& text, WindowQuery* query) {
+    size_t open = text.find('(');
+    std::string name = text.substr(0, open);
+    int aggregate = 0;
+    while (aggregate < AGG_COUNT_ALL && name != AGGREGATE_NAMES[aggregate]) {
+        aggregate++;
+    }
+    if (aggregate == AGG_COUNT_ALL) {
+        return false;
+    }
+    query->aggregate = static_cast<WindowAggregate>(aggregate);
+    query->column = COL_TS;
+    if (open == std::string::npos) {
+        return query->aggregate == AGG_COUNT;
+    }
+    if (text[text.size() - 1] != ')') {
+        return false;
+    }
+    query->column = parse_result_column(text.substr(open + 1, text.size() - open - 2));
+    return query->column < FIRST_HERO_COLUMN;
+}
+
+int parse_duration_ms(const std::string& text) {
+    char* end = NULL;
+    double value = strtod(text.c_str(), &end);
+    std::string unit = end;
+    double scale = unit.empty() || unit == "ms" ? 1 : unit == "s" ? 1000 : unit == "m" ? 60000 : 0;
+    return value > 0 ? static_cast<int>(value * scale) : 0;
+}
+
+bool run_window_query(const ColumnReader& reader, const WindowQuery& query, std::vector<WindowResult>* results) {
+    results->clear();
+    if (query.window_ms <= 0 || query.step_ms <= 0) {
+        return false;
+    }
+    const int pane_ms = gcd(query.window_ms, query.step_ms);
+    std::vector<ChunkPanes> chunk_panes(reader.chunks());
+    cv::parallel_for_(cv::Range(0, static_cast<int>(reader.chunks())), WindowScanBody(&reader, &query, pane_ms, &chunk_panes));
+
+    // chunks are in timestamp order, so merging them in order keeps first / last / rises right;
+    // like the chunk scan, unsorted input is aggregated rather than failed, panes start at the
+    // earliest chunk wherever it is in the file
+    int first_pane = std::numeric_limits<int>::max();
+    for (size_t c = 0; c < chunk_panes.size(); c++) {
+        if (!chunk_panes[c].ok) {
+            return false;
+        }
+        if (!chunk_panes[c].panes.empty()) {
+            first_pane = std::min(first_pane, chunk_panes[c].first_pane);
+        }
+    }
+    std::vector<Pane> panes;
+    for (size_t c = 0; c < chunk_panes.size(); c++) {
+        const ChunkPanes& chunk = chunk_panes[c];
+        if (chunk.panes.empty()) {
+            continue;
+        }
+        Pane empty = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+        size_t end = chunk.first_pane - first_pane + chunk.panes.size();
+        if (panes.size() < end) {
+            panes.resize(end, empty);
+        }
+        for (size_t p = 0; p < chunk.panes.size(); p++) {
+            merge_pane(&panes[chunk.first_pane - first_pane + p], chunk.panes[p]);
+        }
+    }
+    if (panes.empty()) {
+        return true;
+    }
+
+    // every window starting at a step boundary that overlaps the data
+    const int window_panes = query.window_ms / pane_ms;
+    const int step_panes = query.step_ms / pane_ms;
+    const int last_pane = first_pane + static_cast<int>(panes.size()) - 1;
+    int start = -floor_div(window_panes - 1 - first_pane, step_panes) * step_panes;
+    for (; start <= last_pane; start += step_panes) {
+        Pane window = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+        for (int p = std::max(start, first_pane); p < start + window_panes && p <= last_pane; p++) {
+            merge_pane(&window, panes[p - first_pane]);
+        }
+        WindowResult result;
+        result.start_ts = start * pane_ms;
+        result.frames = window.frames;
+        result.value = std::numeric_limits<double>::quiet_NaN();
+        if (query.aggregate == AGG_COUNT) {
+            result.value = window.frames;
+        } else if (window.frames > 0) {
+            switch (query.aggregate) {
+                case AGG_MIN:
+                    result.value = window.min;
+                    break;
+                case AGG_MAX:
+                    result.value = window.max;
+                    break;
+                case AGG_MEAN:
+                    result.value = window.sum / window.frames;
+                    break;
+                case AGG_RATE:
+                    result.value = window.last_ts > window.first_ts ? (window.last - window.first) * 1000.0 / (window.last_ts - window.first_ts) : 0;
+                    break;
+                case AGG_RISES:
+                    result.value = window.rises;
+                    break;
+                default:
+                    break;
+            }
+        }
+        results->push_back(result);
+    }
+    return true;
+}
+
+int run_query(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "usage: game_video --query <results.gvc> <count|min|max|mean|rate|rises>(<column>) --window 30s [--step 5s] "
+                  << "[--where <predicate>]... [--threads N]" << std::endl;
+        return -1;
+    }
+    WindowQuery query;
+    if (!parse_window_aggregate(argv[3], &query)) {
+        std::cerr << "Invalid aggregate " << argv[3] << ", expected e.g. count or mean(hero_count)" << std::endl;
+        return -1;
+    }
+    query.window_ms = 0;
+    query.step_ms = 0;
+    int threads = -1;
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        ColumnPredicate predicate;
+        if (arg == "--window" && i + 1 < argc) {
+            query.window_ms = parse_duration_ms(argv[++i]);
+        } else if (arg == "--step" && i + 1 < argc) {
+            query.step_ms = parse_duration_ms(argv[++i]);
+        } else if (arg == "--where" && i + 1 < argc) {
+            if (!parse_column_predicate(argv[++i], &predicate)) {
+                std::cerr << "Invalid predicate " << argv[i] << std::endl;
+                return -1;
+            }
+            query.filters.push_back(predicate);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else {
+            std::cerr << "Unknown query option " << arg << std::endl;
+            return -1;
+        }
+    }
+    if (query.step_ms == 0) {
+        query.step_ms = query.window_ms;
+    }
+    // column chunks are scanned in parallel
+    use_threads(PARALLEL_ACROSS_TASKS, threads);
+    if (query.window_ms <= 0) {
+        std::cerr << "A window length is required, e.g. --window 30s" << std::endl;
+        return -1;
+    }
+
+    ColumnReader reader;
+    if (!reader.open(argv[2])) {
+        std::cerr << "Cannot read column file " << argv[2] << std::endl;
+        return -1;
+    }
+    std::vector<WindowResult> results;
+    int64 start = cv::getTickCount();
+    if (!run_window_query(reader, query, &results)) {
+        std::cerr << "Corrupted column file " << argv[2] << std::endl;
+        return -1;
+    }
+    double ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+    std::cout << "window_start_ms\tframes\t" << argv[3] << std::endl;
+    for (size_t i = 0; i < results.size(); i++) {
+        std::cout << results[i].start_ts << "\t" << results[i].frames << "\t" << results[i].value << std::endl;
+    }
+    std::cerr << results.size() << " windows over " << reader.frames() << " frames in " << ms << " ms" << std::endl;
+    return 0;
+}
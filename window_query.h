@@ -0,0 +1,46 @@
+#ifndef WINDOW_QUERY_H
+#define WINDOW_QUERY_H
+
+#include "column_store.h"
+
+// Tumbling and sliding window aggregation over a column store (.gvc).
+// Windows start at multiples of step_ms; tumbling when step_ms == window_ms. Time is cut into
+// panes of gcd(window_ms, step_ms), chunks are scanned in parallel into per-pane partials
+// (count, sum, min, max, first, last, rises), and each window merges its panes.
+// Only frames passing all filters are aggregated; chunks ruled out by zone maps are not decoded.
+
+enum WindowAggregate {
+    AGG_COUNT = 0,    // frames
+    AGG_MIN,
+    AGG_MAX,
+    AGG_MEAN,
+    AGG_RATE,     // change of the value per second, e.g. rate(money)
+    AGG_RISES,    // times the value rose from one frame to the next, e.g. rises(skill3_cd) counts casts
+    AGG_COUNT_ALL
+};
+
+struct WindowQuery {
+    WindowAggregate aggregate;
+    int column;    // per-frame column, ignored by AGG_COUNT
+    int window_ms;
+    int step_ms;
+    std::vector<ColumnPredicate> filters;
+};
+
+struct WindowResult {
+    int start_ts;
+    size_t frames;
+    double value;    // NaN for windows without frames, except count
+};
+
+// "mean(hero_count)", "count", ..., false on an unknown aggregate or column
+bool parse_window_aggregate(const std::string&, WindowQuery*);
+// "500ms", "30s", "1m" or plain milliseconds, 0 when invalid
+int parse_duration_ms(const std::string&);
+
+bool run_window_query(const ColumnReader&, const WindowQuery&, std::vector<WindowResult>*);
+
+// usage: game_video --query <results.gvc> <aggregate> --window 30s [--step 5s] [--where <predicate>]... [--threads N]
+int run_query(int argc, char** argv);
+
+#endif
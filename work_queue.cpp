@@ -0,0 +1,524 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "work_queue.h"
+#include "auto_tuner.h"
+#include "result_file.h"
+#include "thread_policy.h"
+
+static int64 now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static bool file_exists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+// writes a small file under a unique temporary name, then renames it into place
+static bool write_file_atomic(const std::string& path, const std::string& tmp, const std::string& content) {
+    FILE* file = fopen(tmp.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(content.data(), 1, content.size(), file) == content.size();
+    ok = fflush(file) == 0 && fsync(fileno(file)) == 0 && ok;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool make_work_queue(const std::string& queue_dir, const std::string& frames_folder, const size_t& chunk, const size_t& overlap) {
+    std::vector<cv::String> filenames;
+    cv::glob(frames_folder, filenames);
+    if (filenames.empty()) {
+        std::cerr << "No frames found in " << frames_folder << std::endl;
+        return false;
+    }
+    const char* subdirs[] = {"", "/leases", "/results", "/done", "/failed"};
+    for (size_t i = 0; i < sizeof(subdirs) / sizeof(subdirs[0]); i++) {
+        std::string dir = queue_dir + subdirs[i];
+        if (mkdir(dir.c_str(), 0775) != 0 && errno != EEXIST) {
+            std::cerr << "Cannot create " << dir << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+
+    std::ostringstream manifest;
+    size_t items = 0;
+    for (size_t start = 0; start < filenames.size(); start += chunk) {
+        size_t first = start > overlap ? start - overlap : 0;
+        size_t last = std::min(filenames.size(), start + chunk);
+        manifest << frames_folder << ' ' << first << ' ' << last << '\n';
+        items++;
+    }
+    std::string path = queue_dir + "/manifest.txt";
+    if (!write_file_atomic(path, path + ".tmp", manifest.str())) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return false;
+    }
+    std::cout << "Queued " << items << " item(s) of " << filenames.size() << " frames in " << queue_dir << std::endl;
+    return true;
+}
+
+bool load_work_queue(const std::string& queue_dir, std::vector<WorkItem>* items) {
+    std::ifstream manifest((queue_dir + "/manifest.txt").c_str());
+    if (!manifest) {
+        return false;
+    }
+    items->clear();
+    std::string line;
+    while (std::getline(manifest, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        WorkItem item;
+        std::istringstream fields(line);
+        if (!(fields >> item.folder >> item.first >> item.last)) {
+            std::cerr << "Malformed manifest line: " << line << std::endl;
+            return false;
+        }
+        char id[32];
+        snprintf(id, sizeof(id), "item_%06zu", items->size());
+        item.id = id;
+        items->push_back(item);
+    }
+    return true;
+}
+
+// content of the generation that ends a lease, expired and owned by no worker
+static const char* RELEASED_LEASE = "- 0\n";
+
+QueueWorker::QueueWorker(const std::string& queue_dir, const int64& lease_ttl_ms, const int& max_attempts)
+    : queue_dir_(queue_dir), lease_ttl_ms_(lease_ttl_ms), max_attempts_(max_attempts) {
+    char host[256] = {0};
+    gethostname(host, sizeof(host) - 1);
+    std::ostringstream token;
+    token << host << '.' << getpid() << '.' << now_ms();
+    token_ = token.str();
+}
+
+std::string QueueWorker::lease_content() const {
+    std::ostringstream content;
+    content << token_ << ' ' << now_ms() + lease_ttl_ms_ << '\n';
+    return content.str();
+}
+
+bool QueueWorker::is_done(const WorkItem& item) const {
+    return file_exists(done_path(item));
+}
+
+int64 QueueWorker::lease_generation(const WorkItem& item) const {
+    DIR* dir = opendir(lease_dir(item).c_str());
+    if (!dir) {
+        return 0;
+    }
+    int64 generation = 0;
+    while (struct dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            generation = std::max<int64>(generation, std::atoll(entry->d_name));
+        }
+    }
+    closedir(dir);
+    return generation;
+}
+
+bool QueueWorker::read_lease(const std::string& path, std::string* owner, int64* expiry) const {
+    std::ifstream lease(path.c_str());
+    if (!lease) {
+        return false;
+    }
+    if (!(lease >> *owner >> *expiry)) {
+        // leases are linked into place complete, still treat garbage as expiring a ttl after its creation
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            return false;
+        }
+        owner->clear();
+        *expiry = static_cast<int64>(st.st_mtime) * 1000 + lease_ttl_ms_;
+    }
+    return true;
+}
+
+bool QueueWorker::holds(const WorkItem& item, int64* generation) const {
+    *generation = lease_generation(item);
+    std::string owner;
+    int64 expiry;
+    return *generation > 0 && read_lease(lease_path(item, *generation), &owner, &expiry) && owner == token_;
+}
+
+bool QueueWorker::create_lease(const WorkItem& item, const int64& generation, const std::string& content) {
+    std::string tmp = queue_dir_ + "/leases/." + item.id + "." + token_;
+    FILE* file = fopen(tmp.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(content.data(), 1, content.size(), file) == content.size();
+    ok = fclose(file) == 0 && ok;
+    bool created = false;
+    if (ok) {
+        // link() fails if the generation exists; on NFS its reply may get lost, then the link count tells
+        struct stat st;
+        created = link(tmp.c_str(), lease_path(item, generation).c_str()) == 0 ||
+                  (stat(tmp.c_str(), &st) == 0 && st.st_nlink == 2);
+    }
+    unlink(tmp.c_str());
+    if (created && generation > 2) {
+        // the previous generation stays for workers that listed the item just before this one
+        unlink(lease_path(item, generation - 2).c_str());
+    }
+    return created;
+}
+
+int QueueWorker::failed_attempts(const WorkItem& item) const {
+    DIR* dir = opendir((queue_dir_ + "/failed").c_str());
+    if (!dir) {
+        return 0;
+    }
+    int attempts = 0;
+    std::string prefix = item.id + ".";
+    while (struct dirent* entry = readdir(dir)) {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            attempts++;
+        }
+    }
+    closedir(dir);
+    return attempts;
+}
+
+bool QueueWorker::try_claim(const WorkItem& item) {
+    if (is_done(item) || failed_attempts(item) >= max_attempts_) {
+        return false;
+    }
+    int64 generation = lease_generation(item);
+    std::string owner;
+    int64 expiry = 0;
+    // a generation that cannot be read anymore was superseded while we looked
+    if (generation > 0 && (!read_lease(lease_path(item, generation), &owner, &expiry) || expiry > now_ms())) {
+        return false;
+    }
+    if (generation == 0 && mkdir(lease_dir(item).c_str(), 0775) != 0 && errno != EEXIST) {
+        return false;
+    }
+    // competing claims and the owner's heartbeat all try to create the next generation, one succeeds
+    if (!create_lease(item, generation + 1, lease_content())) {
+        return false;
+    }
+    if (generation > 0 && expiry > 0) {
+        std::cout << "Worker " << token_ << " reclaimed expired lease of " << item.id << " from " << owner << std::endl;
+    }
+    return true;
+}
+
+bool QueueWorker::owns(const WorkItem& item) const {
+    int64 generation;
+    return holds(item, &generation);
+}
+
+bool QueueWorker::renew(const WorkItem& item) {
+    int64 generation;
+    if (!holds(item, &generation)) {
+        return false;
+    }
+    // fails when a worker that found the lease expired reclaimed it first
+    return create_lease(item, generation + 1, lease_content());
+}
+
+void QueueWorker::release(const WorkItem& item) {
+    int64 generation;
+    if (is_done(item)) {
+        // nobody claims a done item, its lease folder is removed by whoever releases it
+        DIR* dir = opendir(lease_dir(item).c_str());
+        if (!dir) {
+            return;
+        }
+        while (struct dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') {
+                unlink((lease_dir(item) + "/" + entry->d_name).c_str());
+            }
+        }
+        closedir(dir);
+        rmdir(lease_dir(item).c_str());
+    } else if (holds(item, &generation)) {
+        // if the lease was reclaimed meanwhile, this generation is taken and the new owner keeps it
+        create_lease(item, generation + 1, RELEASED_LEASE);
+    }
+}
+
+void QueueWorker::mark_failed(const WorkItem& item) {
+    // a new marker per attempt, a single worker retrying an item still runs out of attempts
+    for (int attempt = 1; attempt <= max_attempts_; attempt++) {
+        std::string path = queue_dir_ + "/failed/" + item.id + "." + token_ + "." + std::to_string(attempt);
+        int fd = open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0664);
+        if (fd >= 0) {
+            close(fd);
+            return;
+        }
+        if (errno != EEXIST) {
+            return;
+        }
+    }
+}
+
+bool QueueWorker::commit(const WorkItem& item, const std::string& result_tmp) {
+    if (is_done(item)) {
+        unlink(result_tmp.c_str());
+        return false;
+    }
+    std::string result = queue_dir_ + "/results/" + item.id + ".gvr";
+    if (rename(result_tmp.c_str(), result.c_str()) != 0) {
+        unlink(result_tmp.c_str());
+        return false;
+    }
+    int fd = open(done_path(item).c_str(), O_CREAT | O_EXCL | O_WRONLY, 0664);
+    if (fd < 0) {
+        return errno == EEXIST;
+    }
+    close(fd);
+    return true;
+}
+
+WorkResult QueueWorker::process(const WorkItem& item, const NumberSamples& samples, const std::string& profile, const std::atomic<bool>& lost) {
+    std::vector<cv::String> filenames;
+    cv::glob(item.folder, filenames);
+    size_t last = std::min(item.last, filenames.size());
+
+    GameVideoAnalyzer game_video_analyzer;
+    game_video_analyzer.set_display(false);
+
+    std::string result_tmp = queue_dir_ + "/results/." + item.id + "." + token_ + ".tmp";
+    ResultWriter writer;
+    if (!writer.open(result_tmp)) {
+        std::cerr << "Cannot write " << result_tmp << std::endl;
+        return WORK_FAILED;
+    }
+    for (size_t i = item.first; i < last; i++) {
+        if (lost) {
+            std::cerr << "Worker " << token_ << " lost lease of " << item.id << std::endl;
+            writer.close();
+            unlink(result_tmp.c_str());
+            return WORK_LOST;
+        }
+        cv::Mat src = cv::imread(filenames[i]);
+        if (!src.data) {
+            std::cerr << "Fail reading image " << filenames[i] << std::endl;
+            writer.close();
+            unlink(result_tmp.c_str());
+            return WORK_FAILED;
+        }
+        if (i == item.first) {
+            PipelineParams params = DEFAULT_PIPELINE_PARAMS;
+            load_pipeline_profile(profile, src.size(), &params);
+            apply_pipeline_params(params, &game_video_analyzer);
+        }
+        game_video_analyzer.adjust_size(&src);
+        FrameStatus status;
+        game_video_analyzer.process_frame(&src, parse_frame_timestamp(filenames[i]), samples, &status);
+        if (!writer.write(status)) {
+            break;
+        }
+    }
+    if (!writer.close()) {
+        unlink(result_tmp.c_str());
+        return WORK_FAILED;
+    }
+    if (!owns(item)) {
+        std::cerr << "Worker " << token_ << " lost lease of " << item.id << std::endl;
+        unlink(result_tmp.c_str());
+        return WORK_LOST;
+    }
+    if (!commit(item, result_tmp)) {
+        std::cout << "Worker " << token_ << " discarded duplicate result of " << item.id << std::endl;
+    }
+    return WORK_DONE;
+}
+
+// renews a lease every third of its ttl until stopped
+class LeaseHeartbeat {
+  private:
+    QueueWorker* worker_;
+    const WorkItem* item_;
+    std::atomic<bool>* lost_;
+    bool stop_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!cv_.wait_for(lock, std::chrono::milliseconds(worker_->lease_ttl_ms() / 3), [this] { return stop_; })) {
+            if (!worker_->renew(*item_)) {
+                *lost_ = true;
+                return;
+            }
+        }
+    }
+
+  public:
+    LeaseHeartbeat(QueueWorker* worker, const WorkItem* item, std::atomic<bool>* lost)
+        : worker_(worker), item_(item), lost_(lost), stop_(false) {
+        thread_ = std::thread(&LeaseHeartbeat::run, this);
+    }
+    ~LeaseHeartbeat() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+};
+
+static int worker_loop(const std::string& queue_dir, const int64& lease_ttl_ms, const int& max_attempts,
+                       const std::string& profile, const std::string& samples_folder) {
+    std::vector<WorkItem> items;
+    if (!load_work_queue(queue_dir, &items)) {
+        std::cerr << "Cannot load work queue " << queue_dir << std::endl;
+        return -1;
+    }
+    NumberSamples samples;
+    if (!load_number_samples(samples_folder, &samples)) {
+        return -1;
+    }
+    QueueWorker worker(queue_dir, lease_ttl_ms, max_attempts);
+    // workers start scanning at different items to reduce contention on the same leases
+    size_t start = std::hash<std::string>()(worker.token()) % std::max<size_t>(1, items.size());
+    size_t processed = 0;
+    while (true) {
+        size_t remaining = 0, failed = 0;
+        bool claimed = false;
+        for (size_t k = 0; k < items.size() && !claimed; k++) {
+            const WorkItem& item = items[(start + k) % items.size()];
+            if (worker.is_done(item)) {
+                continue;
+            }
+            if (worker.failed_attempts(item) >= max_attempts) {
+                failed++;
+                continue;
+            }
+            remaining++;
+            if (!worker.try_claim(item)) {
+                continue;
+            }
+            claimed = true;
+            std::cout << "Worker " << worker.token() << " claimed " << item.id << ": " << item.folder
+                      << " [" << item.first << ", " << item.last << ")" << std::endl;
+            std::atomic<bool> lost(false);
+            WorkResult result;
+            {
+                LeaseHeartbeat heartbeat(&worker, &item, &lost);
+                result = worker.process(item, samples, profile, lost);
+            }
+            // a lease lost to a reclaim is no failure of the item, its new owner carries on
+            if (result == WORK_FAILED) {
+                worker.mark_failed(item);
+            } else if (result == WORK_DONE) {
+                processed++;
+            }
+            worker.release(item);
+        }
+        if (remaining == 0) {
+            std::cout << "Worker " << worker.token() << " finished, " << processed << " item(s) processed, "
+                      << failed << " item(s) failed permanently" << std::endl;
+            return failed == 0 ? 0 : 1;
+        }
+        if (!claimed) {
+            // everything left is leased by others, wait for them to finish or expire
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::min<int64>(1000, lease_ttl_ms / 4)));
+        }
+    }
+}
+
+int run_make_queue(int argc, char** argv) {
+    if (argc < 4) {
+        std::cerr << "usage: game_video --make-queue <queue> <frames folder> [--chunk 1000] [--overlap 30]" << std::endl;
+        return -1;
+    }
+    size_t chunk = 1000, overlap = 30;
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--chunk" && i + 1 < argc) {
+            chunk = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--overlap" && i + 1 < argc) {
+            overlap = std::max(0, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Unknown queue option " << arg << std::endl;
+            return -1;
+        }
+    }
+    return make_work_queue(argv[2], argv[3], chunk, overlap) ? 0 : -1;
+}
+
+int run_worker(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: game_video --worker <queue> [--workers 1] [--lease-ttl 60] [--max-attempts 3]" << std::endl;
+        return -1;
+    }
+    std::string queue_dir = argv[2];
+    int workers = 1;
+    double lease_ttl = 60;
+    int max_attempts = 3;
+    std::string profile = default_profile_path();
+    std::string samples_folder = "../samples";
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--workers" && has_value) {
+            workers = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--lease-ttl" && has_value) {
+            lease_ttl = std::max(1.0, std::atof(argv[++i]));
+        } else if (arg == "--max-attempts" && has_value) {
+            max_attempts = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--profile" && has_value) {
+            profile = argv[++i];
+        } else if (arg == "--samples" && has_value) {
+            samples_folder = argv[++i];
+        } else {
+            std::cerr << "Unknown worker option " << arg << std::endl;
+            return -1;
+        }
+    }
+    int64 lease_ttl_ms = static_cast<int64>(lease_ttl * 1000);
+    if (workers == 1) {
+        return worker_loop(queue_dir, lease_ttl_ms, max_attempts, profile, samples_folder);
+    }
+
+    // local worker processes share nothing but the queue folder, like workers on other nodes,
+    // and each sizes its threads from its share of this machine
+    set_process_share(workers);
+    std::vector<pid_t> children;
+    for (int i = 0; i < workers; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(worker_loop(queue_dir, lease_ttl_ms, max_attempts, profile, samples_folder) == 0 ? 0 : 1);
+        } else if (pid < 0) {
+            std::cerr << "Cannot fork worker: " << strerror(errno) << std::endl;
+            break;
+        }
+        children.push_back(pid);
+    }
+    int result = children.size() == static_cast<size_t>(workers) ? 0 : 1;
+    for (size_t i = 0; i < children.size(); i++) {
+        int status = 0;
+        waitpid(children[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            result = 1;
+        }
+    }
+    return result;
+}
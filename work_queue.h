@@ -0,0 +1,108 @@
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <atomic>
+#include "game_video.h"
+
+// Coordinator-less distributed batch processing through a shared filesystem (NFS, Lustre, ...).
+//
+// <queue>/manifest.txt   one work item per line: <frames folder> <first frame> <last frame (exclusive)>
+// <queue>/leases/<item>/ <generation> files of the lease of the worker processing the item, renewed by heartbeats
+// <queue>/results/       <item>.gvr per-frame results, see result_file.h
+// <queue>/done/          <item>.done markers of finished items
+// <queue>/failed/        <item>.<worker>.<attempt> markers of failed attempts, one per attempt
+//
+// A lease is a sequence of generations, each created once with link(), which is atomic on NFS too,
+// and never rewritten; the highest one is current. Claiming, reclaiming an expired lease, renewing
+// and releasing all create the next generation, so when workers change a lease at the same time
+// exactly one of them does, and a heartbeat racing a reclaim either keeps or loses the lease whole.
+// Whoever creates a generation removes the one two before it, so finding the current generation
+// lists the two or three files of that item only.
+// Items are idempotent: if a stalled worker comes back after its lease was reclaimed, its duplicate
+// result is discarded since the done marker exists.
+//
+// A lease expires at a wall clock time written by its owner and compared by other workers against
+// their own clocks: the nodes sharing a queue need synchronized clocks (NTP), skewed by far less
+// than the lease ttl. A node whose clock runs ahead reclaims leases early, while they are still
+// renewed, and a node behind holds on to the leases of dead workers for longer.
+
+struct WorkItem {
+    std::string id;
+    std::string folder;
+    size_t first;
+    size_t last;
+};
+
+// outcome of processing an item
+enum WorkResult {
+    WORK_DONE = 0,
+    WORK_FAILED,    // the item could not be processed, counts as a failed attempt
+    WORK_LOST       // the lease went to another worker, no attempt of this item failed
+};
+
+// one worker process, identified by host, pid and start time
+class QueueWorker {
+  private:
+    std::string queue_dir_;
+    std::string token_;
+    int64 lease_ttl_ms_;
+    int max_attempts_;
+
+    std::string lease_dir(const WorkItem& item) const {
+        return queue_dir_ + "/leases/" + item.id;
+    }
+    std::string lease_path(const WorkItem& item, const int64& generation) const {
+        return lease_dir(item) + "/" + std::to_string(generation);
+    }
+    std::string done_path(const WorkItem& item) const {
+        return queue_dir_ + "/done/" + item.id + ".done";
+    }
+
+    // highest lease generation of the item, 0 if it was never leased
+    int64 lease_generation(const WorkItem& item) const;
+    bool read_lease(const std::string& path, std::string* owner, int64* expiry) const;
+    // whether the current generation is this worker's, which is then stored in generation
+    bool holds(const WorkItem& item, int64* generation) const;
+    // false if another worker created this generation first, else drops generation - 2
+    bool create_lease(const WorkItem& item, const int64& generation, const std::string& content);
+    std::string lease_content() const;
+
+  public:
+    QueueWorker(const std::string& queue_dir, const int64& lease_ttl_ms, const int& max_attempts);
+
+    inline const std::string& token() const {
+        return token_;
+    }
+    inline int64 lease_ttl_ms() const {
+        return lease_ttl_ms_;
+    }
+    bool is_done(const WorkItem& item) const;
+    int failed_attempts(const WorkItem& item) const;
+
+    bool try_claim(const WorkItem& item);
+    bool owns(const WorkItem& item) const;
+    // false if the lease was lost to another worker
+    bool renew(const WorkItem& item);
+    // leaves a reclaimed lease to its new owner, and removes the lease of a done item
+    void release(const WorkItem& item);
+    // counts one more failed attempt, also when this worker failed the item before
+    void mark_failed(const WorkItem& item);
+    // moves result into place and marks the item done, false if another worker finished it first
+    bool commit(const WorkItem& item, const std::string& result_tmp);
+
+    // the pipeline profile applies when calibrated for the item's frame size
+    WorkResult process(const WorkItem& item, const NumberSamples& samples, const std::string& profile, const std::atomic<bool>& lost);
+};
+
+// splits a frames folder into chunks, each chunk starts overlap frames early to warm up hero tracking
+bool make_work_queue(const std::string& queue_dir, const std::string& frames_folder, const size_t& chunk, const size_t& overlap);
+bool load_work_queue(const std::string& queue_dir, std::vector<WorkItem>*);
+
+// usage: game_video --make-queue <queue> <frames folder> [--chunk 1000] [--overlap 30]
+int run_make_queue(int argc, char** argv);
+
+// usage: game_video --worker <queue> [--workers 1] [--lease-ttl 60] [--max-attempts 3] [--profile file] [--samples ../samples]
+// --workers forks local worker processes, e.g. to test the queue on one machine
+int run_worker(int argc, char** argv);
+
+#endif